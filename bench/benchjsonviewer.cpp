@@ -0,0 +1,515 @@
+#include <benchmark/benchmark.h>
+#include <QApplication>
+#include <QByteArray>
+#include <QJsonDocument>
+#include <QPlainTextDocumentLayout>
+#include <QStringList>
+#include <QTextDocument>
+#include "jsoncorpus.h"
+#include "jsonhighlighter.h"
+#include "jsonmodel.h"
+#include "jsonparser.h"
+#include "jsonlexer.h"
+#include "jsonscanner.h"
+#include "jsonsearchindex.h"
+#include "recursivejsonparser.h"
+#include "textlineindex.h"
+
+static QByteArray makeFlatArray(int count)
+{
+  QByteArray json;
+  json.reserve(count * 2 + 2);
+  json.append('[');
+  for (int i = 0; i < count; ++i)
+  {
+    if (i > 0)
+    {
+      json.append(',');
+    }
+    json.append('0');
+  }
+  json.append(']');
+  return json;
+}
+
+// Имитация прокрутки в конце плоского массива: стоимость одного окна
+// из 1000 строк не должна зависеть от числа соседних элементов.
+static void BM_ScrollFlatArrayParent(benchmark::State &state)
+{
+  const int count = static_cast<int>(state.range(0));
+  JsonModel model;
+  model.loadJson(makeFlatArray(count));
+  QModelIndex root = model.rootIndex();
+  const int window = 1000;
+
+  for (auto _ : state)
+  {
+    for (int row = count - window; row < count; ++row)
+    {
+      QModelIndex child = model.index(row, 0, root);
+      benchmark::DoNotOptimize(model.parent(child));
+    }
+  }
+  state.SetComplexityN(count);
+  state.SetItemsProcessed(state.iterations() * window);
+}
+BENCHMARK(BM_ScrollFlatArrayParent)->RangeMultiplier(8)->Range(1 << 10, 1 << 19)->Complexity(benchmark::o1);
+
+// Отформатированный массив записей: много пробелов, строк и чисел, как в типичных выгрузках.
+static QByteArray makeRecords(int count)
+{
+  QByteArray json = "[\n";
+  for (int i = 0; i < count; ++i)
+  {
+    json += i > 0 ? ",\n" : "";
+    json += "  {\n    \"id\": " + QByteArray::number(i) +
+        ",\n    \"name\": \"user " + QByteArray::number(i) + " with a reasonably long display name\"" +
+        ",\n    \"email\": \"user" + QByteArray::number(i) + "@example.com\"" +
+        ",\n    \"score\": " + QByteArray::number(i * 0.37) +
+        ",\n    \"active\": " + (i % 2 ? "true" : "false") +
+        ",\n    \"note\": \"quoted \\\"text\\\" and escapes \\n inside\"\n  }";
+  }
+  json += "\n]\n";
+  return json;
+}
+
+// Пропускная способность разбора при разных уровнях первой стадии.
+// Scalar - те же маски и переходы по ним, только построенные без SIMD-инструкций;
+// прежний посимвольный разбор без масок замеряет BM_ParseRecordsRecursive/bytewise:1.
+static void BM_ParseRecords(benchmark::State &state)
+{
+  JsonScanner::Level level = static_cast<JsonScanner::Level>(state.range(0));
+  if (level > JsonScanner::bestLevel())
+  {
+    state.SkipWithError("instruction set is not supported");
+    return;
+  }
+  JsonScanner::setLevel(level);
+  QByteArray json = makeRecords(50000);
+
+  for (auto _ : state)
+  {
+    JsonTree tree;
+    JsonParser parser;
+    benchmark::DoNotOptimize(parser.parse(json, tree));
+  }
+  state.SetBytesProcessed(state.iterations() * json.size());
+  JsonScanner::setLevel(JsonScanner::bestLevel());
+}
+BENCHMARK(BM_ParseRecords)->ArgName("level")->DenseRange(JsonScanner::Scalar, JsonScanner::Avx2)->Unit(benchmark::kMillisecond);
+
+// Точка отсчета для BM_ParseRecords: тот же документ через QJsonDocument,
+// которым просмотрщик проверял текст до появления собственного парсера.
+static void BM_ParseRecordsQJsonDocument(benchmark::State &state)
+{
+  QByteArray json = makeRecords(50000);
+
+  for (auto _ : state)
+  {
+    QJsonParseError error;
+    benchmark::DoNotOptimize(QJsonDocument::fromJson(json, &error).isNull());
+  }
+  state.SetBytesProcessed(state.iterations() * json.size());
+}
+BENCHMARK(BM_ParseRecordsQJsonDocument)->Unit(benchmark::kMillisecond);
+
+// Только первая стадия: классификация блоков по 64 байта.
+static void BM_ClassifyBlocks(benchmark::State &state)
+{
+  JsonScanner::Level level = static_cast<JsonScanner::Level>(state.range(0));
+  if (level > JsonScanner::bestLevel())
+  {
+    state.SkipWithError("instruction set is not supported");
+    return;
+  }
+  JsonScanner::setLevel(level);
+  QByteArray json = makeRecords(50000);
+
+  for (auto _ : state)
+  {
+    ScanBlock block;
+    for (int pos = 0; pos < json.size(); pos += 64)
+    {
+      JsonScanner::classify(json.constData() + pos, json.size() - pos, block);
+      benchmark::DoNotOptimize(block);
+    }
+  }
+  state.SetBytesProcessed(state.iterations() * json.size());
+  JsonScanner::setLevel(JsonScanner::bestLevel());
+}
+BENCHMARK(BM_ClassifyBlocks)->ArgName("level")->DenseRange(JsonScanner::Scalar, JsonScanner::Avx2)->Unit(benchmark::kMillisecond);
+
+// Масштабирование разбора большого корневого массива по числу потоков.
+static void BM_ParseRecordsThreads(benchmark::State &state)
+{
+  QByteArray json = makeRecords(100000);
+
+  for (auto _ : state)
+  {
+    JsonTree tree;
+    JsonParser parser;
+    parser.setThreadCount(static_cast<int>(state.range(0)));
+    benchmark::DoNotOptimize(parser.parse(json, tree));
+  }
+  state.SetBytesProcessed(state.iterations() * json.size());
+}
+BENCHMARK(BM_ParseRecordsThreads)->ArgName("threads")->RangeMultiplier(2)->Range(1, 8)->UseRealTime()->Unit(benchmark::kMillisecond);
+
+
+// Правка одного значения в середине большого документа: частичное обновление модели
+// против полной перезагрузки (arg 1).
+static void BM_UpdateSingleValue(benchmark::State &state)
+{
+  QByteArray json = makeRecords(100000);
+  QByteArray edited = json;
+  int pos = edited.indexOf("\"id\": 50000,");
+  edited.replace(pos, 13, "\"id\": 50001,");
+  const bool full = state.range(0) != 0;
+  JsonModel model;
+  model.loadJson(json);
+
+  bool toggle = false;
+  for (auto _ : state)
+  {
+    toggle = !toggle;
+    const QByteArray &text = toggle ? edited : json;
+    if (full)
+    {
+      model.loadJson(text);
+    }
+    else
+    {
+      benchmark::DoNotOptimize(model.updateSource(text));
+    }
+  }
+  state.SetBytesProcessed(state.iterations() * json.size());
+}
+BENCHMARK(BM_UpdateSingleValue)->ArgName("full")->DenseRange(0, 1)->Unit(benchmark::kMillisecond);
+
+
+// Глубоко вложенный документ: [{"k": [{"k": ... 0 ...}]}].
+static QByteArray makeDeep(int depth)
+{
+  QByteArray json;
+  for (int i = 0; i < depth; ++i)
+  {
+    json += i % 2 ? "{\"k\": " : "[";
+  }
+  json += "0";
+  for (int i = depth - 1; i >= 0; --i)
+  {
+    json += i % 2 ? "}" : "]";
+  }
+  return json;
+}
+
+// 100 глубоких документов в одном массиве.
+static QByteArray makeDeepDocument(int depth)
+{
+  QByteArray json;
+  for (int i = 0; i < 100; ++i)
+  {
+    json += i > 0 ? "," : "[";
+    json += makeDeep(depth);
+  }
+  json += "]";
+  return json;
+}
+
+// Разбор глубокой вложенности (arg - глубина) и широкого документа из небольших записей.
+// Стоимость на байт не должна зависеть от формы дерева.
+static void BM_ParseDeep(benchmark::State &state)
+{
+  QByteArray json = makeDeepDocument(static_cast<int>(state.range(0)));
+
+  for (auto _ : state)
+  {
+    JsonTree tree;
+    JsonParser parser;
+    benchmark::DoNotOptimize(parser.parse(json, tree));
+  }
+  state.SetBytesProcessed(state.iterations() * json.size());
+}
+BENCHMARK(BM_ParseDeep)->ArgName("depth")->RangeMultiplier(10)->Range(10, 10000)->Unit(benchmark::kMillisecond);
+
+// Точка отсчета для BM_ParseDeep: тот же документ через копию прежнего рекурсивного
+// разбора (RecursiveJsonParser), с теми же глубинами. Дерево у обоих одинаковое.
+static void BM_ParseDeepRecursive(benchmark::State &state)
+{
+  QByteArray json = makeDeepDocument(static_cast<int>(state.range(0)));
+
+  for (auto _ : state)
+  {
+    JsonTree tree;
+    RecursiveJsonParser parser;
+    benchmark::DoNotOptimize(parser.parse(json, tree));
+  }
+  state.SetBytesProcessed(state.iterations() * json.size());
+}
+BENCHMARK(BM_ParseDeepRecursive)->ArgName("depth")->RangeMultiplier(10)->Range(10, 10000)->Unit(benchmark::kMillisecond);
+
+// Еще одна точка отсчета: рекурсивный разборщик QJsonDocument.
+// Глубже 1024 он не разбирает, поэтому только до 1000.
+static void BM_ParseDeepQJsonDocument(benchmark::State &state)
+{
+  QByteArray json = makeDeepDocument(static_cast<int>(state.range(0)));
+
+  for (auto _ : state)
+  {
+    QJsonParseError error;
+    benchmark::DoNotOptimize(QJsonDocument::fromJson(json, &error).isNull());
+  }
+  state.SetBytesProcessed(state.iterations() * json.size());
+}
+BENCHMARK(BM_ParseDeepQJsonDocument)->ArgName("depth")->RangeMultiplier(10)->Range(10, 1000)->Unit(benchmark::kMillisecond);
+
+static void BM_ParseWide(benchmark::State &state)
+{
+  QByteArray json = makeRecords(100000);
+
+  for (auto _ : state)
+  {
+    JsonTree tree;
+    JsonParser parser;
+    parser.setThreadCount(1);
+    benchmark::DoNotOptimize(parser.parse(json, tree));
+  }
+  state.SetBytesProcessed(state.iterations() * json.size());
+}
+BENCHMARK(BM_ParseWide)->Unit(benchmark::kMillisecond);
+
+static void BM_ParseWideRecursive(benchmark::State &state)
+{
+  QByteArray json = makeRecords(100000);
+
+  for (auto _ : state)
+  {
+    JsonTree tree;
+    RecursiveJsonParser parser;
+    benchmark::DoNotOptimize(parser.parse(json, tree));
+  }
+  state.SetBytesProcessed(state.iterations() * json.size());
+}
+BENCHMARK(BM_ParseWideRecursive)->Unit(benchmark::kMillisecond);
+
+// Точка отсчета для BM_ParseRecords: копия прежнего разбора с масками JsonScanner
+// (bytewise:0) и с посимвольными циклами, как до появления первой стадии (bytewise:1).
+static void BM_ParseRecordsRecursive(benchmark::State &state)
+{
+  QByteArray json = makeRecords(50000);
+
+  for (auto _ : state)
+  {
+    JsonTree tree;
+    RecursiveJsonParser parser;
+    parser.setBytewise(state.range(0) != 0);
+    benchmark::DoNotOptimize(parser.parse(json, tree));
+  }
+  state.SetBytesProcessed(state.iterations() * json.size());
+}
+BENCHMARK(BM_ParseRecordsRecursive)->ArgName("bytewise")->DenseRange(0, 1)->Unit(benchmark::kMillisecond);
+
+
+// Построение индекса поиска и запросы к нему: редкая подстрока, частая и короче триграммы.
+static void BM_BuildSearchIndex(benchmark::State &state)
+{
+  QByteArray json = makeRecords(100000);
+
+  for (auto _ : state)
+  {
+    JsonSearchIndex index;
+    index.build(json);
+    benchmark::DoNotOptimize(index.tokenCount());
+  }
+  state.SetBytesProcessed(state.iterations() * json.size());
+}
+BENCHMARK(BM_BuildSearchIndex)->Unit(benchmark::kMillisecond);
+
+static void BM_Search(benchmark::State &state)
+{
+  static const char *queries[] = {"user4242@", "EXAMPLE.COM", "42"};
+  JsonSearchIndex index;
+  index.build(makeRecords(100000));
+  QByteArray query = queries[state.range(0)];
+
+  for (auto _ : state)
+  {
+    benchmark::DoNotOptimize(index.find(query));
+  }
+}
+BENCHMARK(BM_Search)->ArgName("query")->DenseRange(0, 2)->Unit(benchmark::kMicrosecond);
+
+
+// Наборы данных для замеров модели и подсветки - документы JsonCorpus по 8 МБ
+// (все виды, кроме JSON Lines).
+static QByteArray makeCorpus(int kind)
+{
+  return JsonCorpus::generate(static_cast<JsonCorpus::Kind>(kind), 8 << 20);
+}
+
+// Загрузка в модель целиком: разбор и публикация дерева одним сбросом.
+static void BM_LoadJson(benchmark::State &state)
+{
+  QByteArray json = makeCorpus(static_cast<int>(state.range(0)));
+  JsonModel model;
+
+  for (auto _ : state)
+  {
+    benchmark::DoNotOptimize(model.loadJson(json));
+  }
+  state.SetBytesProcessed(state.iterations() * json.size());
+}
+BENCHMARK(BM_LoadJson)->ArgName("corpus")->DenseRange(JsonCorpus::Records, JsonCorpus::Numbers)->Unit(benchmark::kMillisecond);
+
+// Полный обход дерева так, как его выполняет представление:
+// index() для каждой строки, parent() и текст узла.
+static void BM_TraverseModel(benchmark::State &state)
+{
+  JsonModel model;
+  model.loadJson(makeCorpus(static_cast<int>(state.range(0))));
+  int64_t nodes = 0;
+
+  for (auto _ : state)
+  {
+    QVector<QModelIndex> stack;
+    stack.append(QModelIndex());
+    while (!stack.isEmpty())
+    {
+      QModelIndex parent = stack.takeLast();
+      const int rows = model.rowCount(parent);
+      for (int row = 0; row < rows; ++row)
+      {
+        QModelIndex child = model.index(row, 0, parent);
+        benchmark::DoNotOptimize(model.parent(child));
+        benchmark::DoNotOptimize(model.data(child, Qt::DisplayRole));
+        stack.append(child);
+        ++nodes;
+      }
+    }
+  }
+  state.SetItemsProcessed(nodes);
+}
+BENCHMARK(BM_TraverseModel)->ArgName("corpus")->DenseRange(JsonCorpus::Records, JsonCorpus::Numbers)->Unit(benchmark::kMillisecond);
+
+// Освобождение загруженного дерева, загрузка в замер не входит. Число итераций
+// фиксировано: иначе библиотека подбирает его по короткому замеряемому времени
+// и повторяет неучтенную загрузку тысячи раз.
+static void BM_Clear(benchmark::State &state)
+{
+  QByteArray json = makeCorpus(static_cast<int>(state.range(0)));
+  JsonModel model;
+
+  for (auto _ : state)
+  {
+    state.PauseTiming();
+    model.loadJson(json);
+    state.ResumeTiming();
+    model.clear();
+  }
+}
+BENCHMARK(BM_Clear)->ArgName("corpus")->DenseRange(JsonCorpus::Records, JsonCorpus::Numbers)->Iterations(20)->Unit(benchmark::kMillisecond);
+
+// Подсветка вставленного текста: строки разбираются по одной с переносом
+// состояния, как это делает QSyntaxHighlighter. Результат в строках в секунду.
+static void BM_HighlightLines(benchmark::State &state)
+{
+  QStringList lines = QString::fromUtf8(makeCorpus(static_cast<int>(state.range(0)))).split(QLatin1Char('\n'));
+  QVector<JsonToken> tokens;
+
+  for (auto _ : state)
+  {
+    int lexerState = JsonLexer::Normal;
+    for (const QString &line : lines)
+    {
+      tokens.resize(0);
+      lexerState = JsonLexer::tokenize(line, lexerState, tokens);
+    }
+    benchmark::DoNotOptimize(lexerState);
+  }
+  state.counters["lines"] = benchmark::Counter(double(state.iterations()) * lines.size(), benchmark::Counter::kIsRate);
+}
+BENCHMARK(BM_HighlightLines)->ArgName("corpus")->DenseRange(JsonCorpus::Records, JsonCorpus::Numbers)->Unit(benchmark::kMillisecond);
+
+// Документам нужен объект приложения; платформа offscreen, если не задана другая
+static void ensureApplication()
+{
+  if (!QCoreApplication::instance())
+  {
+    if (!qEnvironmentVariableIsSet("QT_QPA_PLATFORM"))
+    {
+      qputenv("QT_QPA_PLATFORM", "offscreen");
+    }
+    static int argc = 1;
+    static char name[] = "BenchJsonViewer";
+    static char *argv[] = {name, nullptr};
+    new QApplication(argc, argv);
+  }
+}
+
+// Подсветка в документе редактора целиком: JsonHighlighter::highlightBlock с setFormat
+// и перекладкой измененных блоков внутри QSyntaxHighlighter. Документ 1 МБ с раскладкой
+// QPlainTextEdit; результат в блоках в секунду, сравнивается с BM_HighlightLines.
+static void BM_RehighlightDocument(benchmark::State &state)
+{
+  ensureApplication();
+  QTextDocument document;
+  document.setDocumentLayout(new QPlainTextDocumentLayout(&document));
+  document.setPlainText(QString::fromUtf8(JsonCorpus::generate(static_cast<JsonCorpus::Kind>(state.range(0)), 1 << 20)));
+  JsonHighlighter highlighter;
+  highlighter.setDocument(&document);
+
+  for (auto _ : state)
+  {
+    highlighter.rehighlight();
+  }
+  state.counters["blocks"] = benchmark::Counter(double(state.iterations()) * document.blockCount(), benchmark::Counter::kIsRate);
+}
+BENCHMARK(BM_RehighlightDocument)->ArgName("corpus")->DenseRange(JsonCorpus::Records, JsonCorpus::Numbers)->Unit(benchmark::kMillisecond);
+
+// Индекс строк для просмотра большого файла строится при каждом открытии.
+static void BM_BuildLineIndex(benchmark::State &state)
+{
+  QByteArray json = makeRecords(100000);
+
+  for (auto _ : state)
+  {
+    TextLineIndex lines;
+    lines.build(json);
+    benchmark::DoNotOptimize(lines.lineCount());
+  }
+  state.SetBytesProcessed(state.iterations() * json.size());
+}
+BENCHMARK(BM_BuildLineIndex)->Unit(benchmark::kMillisecond);
+
+// Раскрытие строк для отображения: без escape-последовательностей (arg 0)
+// и с escape на каждые несколько символов, включая \uXXXX и суррогатные пары (arg 1).
+static void BM_DecodeString(benchmark::State &state)
+{
+  static const char *const parts[][2] = {
+    { "plain ascii text ", "\xd1\x82\xd0\xb5\xd0\xba\xd1\x81\xd1\x82 " },
+    { "tab\\t quote\\\" ", "\\u00e9t\\u00e9 \\ud83d\\ude00\\n" }
+  };
+  const bool escaped = state.range(0) != 0;
+  QVector<QByteArray> strings;
+  qint64 bytes = 0;
+  for (int i = 0; i < 10000; ++i)
+  {
+    QByteArray text;
+    for (int j = 0; j < 8; ++j)
+    {
+      text += parts[escaped][j % 2];
+    }
+    bytes += text.size();
+    strings.append(text);
+  }
+
+  for (auto _ : state)
+  {
+    for (const QByteArray &text : strings)
+    {
+      benchmark::DoNotOptimize(JsonParser::decodeString(text.constData(), text.size()));
+    }
+  }
+  state.SetBytesProcessed(state.iterations() * bytes);
+}
+BENCHMARK(BM_DecodeString)->ArgName("escaped")->DenseRange(0, 1)->Unit(benchmark::kMicrosecond);
@@ -0,0 +1,442 @@
+#include "recursivejsonparser.h"
+#include <cstring>
+
+// Сколько байт проверяется побайтно, прежде чем перейти к маскам JsonScanner.
+static const int kScalarPrefix = 16;
+
+static inline bool isDigit(char c)
+{
+  return c >= '0' && c <= '9';
+}
+
+static inline bool isWhitespace(char c)
+{
+  return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+}
+
+static inline bool isStringSpecial(char c)
+{
+  return c == '"' || c == '\\' || static_cast<unsigned char>(c) < 0x20;
+}
+
+static inline bool isHexDigit(char c)
+{
+  return isDigit(c) || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F');
+}
+
+bool RecursiveJsonParser::parse(const QByteArray &json, JsonTree &tree)
+{
+  tree = JsonTree();
+  m_tree = &tree;
+  m_pending.clear();
+  m_errorOffset = -1;
+
+  tree.m_source = json;
+  m_json = tree.m_source.constData();
+  m_size = tree.m_source.size();
+  m_scanner.reset(m_json, m_size);
+  int pos = skipWhitespace(0);
+  if (pos >= m_size)
+  {
+    setError(pos);
+  }
+  else
+  {
+    pos = parseValue(pos, -1);
+    if (!hasError())
+    {
+      pos = skipWhitespace(pos);
+      if (pos < m_size)
+      {
+        setError(pos);
+      }
+    }
+  }
+
+  m_pending.clear();
+  m_tree = nullptr;
+  if (hasError())
+  {
+    tree = JsonTree();
+    return false;
+  }
+  return true;
+}
+
+void RecursiveJsonParser::setBytewise(bool bytewise)
+{
+  m_bytewise = bytewise;
+}
+
+int RecursiveJsonParser::errorOffset() const
+{
+  return m_errorOffset;
+}
+
+bool RecursiveJsonParser::hasError() const
+{
+  return m_errorOffset >= 0;
+}
+
+void RecursiveJsonParser::setError(int pos)
+{
+  if (!hasError())
+  {
+    m_errorOffset = pos;
+  }
+}
+
+int RecursiveJsonParser::addItem(NodeType type, const TextSpan &key, const TextSpan &value, int parent)
+{
+  int id = m_tree->m_nodes.size();
+  Node node;
+  node.m_parent = parent;
+  if (key.m_offset >= 0)
+  {
+    node.m_keyId = m_tree->m_keys.intern(m_json + key.m_offset, key.m_length);
+  }
+  node.m_value = value;
+  node.m_type = type;
+  m_tree->m_nodes.append(node);
+
+  if (parent >= 0)
+  {
+    m_pending.append(id);
+  }
+  return id;
+}
+
+void RecursiveJsonParser::closeContainer(int id, int firstPending)
+{
+  Node &node = m_tree->m_nodes[id];
+  node.m_firstChild = m_tree->m_childIds.size();
+  node.m_childCount = m_pending.size() - firstPending;
+  for (int i = firstPending; i < m_pending.size(); ++i)
+  {
+    int childId = m_pending.at(i);
+    m_tree->m_nodes[childId].m_row = i - firstPending;
+    m_tree->m_childIds.append(childId);
+  }
+  m_pending.resize(firstPending);
+}
+
+int RecursiveJsonParser::skipWhitespace(int pos)
+{
+  int end = m_bytewise ? m_size : qMin(pos + kScalarPrefix, m_size);
+  for (; pos < end; ++pos)
+  {
+    if (!isWhitespace(m_json[pos]))
+    {
+      return pos;
+    }
+  }
+  return m_bytewise ? pos : m_scanner.skipWhitespace(pos);
+}
+
+bool RecursiveJsonParser::startsWith(int pos, const char *literal, int length) const
+{
+  return pos + length <= m_size && memcmp(m_json + pos, literal, length) == 0;
+}
+
+TextSpan RecursiveJsonParser::parseString(int &pos)
+{
+  TextSpan span;
+  int start = pos;
+  pos++;
+  span.m_offset = pos;
+
+  while (true)
+  {
+    int end = m_bytewise ? m_size : qMin(pos + kScalarPrefix, m_size);
+    while (pos < end && !isStringSpecial(m_json[pos]))
+    {
+      pos++;
+    }
+    if (pos == end && !m_bytewise)
+    {
+      pos = m_scanner.findStringSpecial(pos);
+    }
+    if (pos >= m_size)
+    {
+      break;
+    }
+
+    unsigned char c = static_cast<unsigned char>(m_json[pos]);
+    if (c == '"')
+    {
+      span.m_length = pos - span.m_offset;
+      pos++;
+      return span;
+    }
+    if (c == '\\')
+    {
+      pos++;
+      if (pos >= m_size)
+      {
+        break;
+      }
+      switch (m_json[pos])
+      {
+      case '"':
+      case '\\':
+      case '/':
+      case 'b':
+      case 'f':
+      case 'n':
+      case 'r':
+      case 't':
+        break;
+      case 'u':
+        for (int i = 1; i <= 4; ++i)
+        {
+          if (pos + i >= m_size || !isHexDigit(m_json[pos + i]))
+          {
+            setError(pos - 1);
+            return span;
+          }
+        }
+        pos += 4;
+        break;
+      default:
+        setError(pos - 1);
+        return span;
+      }
+    }
+    else
+    {
+      setError(pos);
+      return span;
+    }
+    pos++;
+  }
+  setError(start);
+  return span;
+}
+
+TextSpan RecursiveJsonParser::parseNumber(int &pos)
+{
+  TextSpan span;
+  span.m_offset = pos;
+  if (m_json[pos] == '-')
+  {
+    pos++;
+  }
+
+  if (pos < m_size && m_json[pos] == '0')
+  {
+    pos++;
+  }
+  else if (pos < m_size && isDigit(m_json[pos]))
+  {
+    while (pos < m_size && isDigit(m_json[pos]))
+    {
+      pos++;
+    }
+  }
+  else
+  {
+    setError(pos);
+    return span;
+  }
+
+  if (pos < m_size && m_json[pos] == '.')
+  {
+    pos++;
+    if (pos >= m_size || !isDigit(m_json[pos]))
+    {
+      setError(pos);
+      return span;
+    }
+    while (pos < m_size && isDigit(m_json[pos]))
+    {
+      pos++;
+    }
+  }
+
+  if (pos < m_size && (m_json[pos] == 'e' || m_json[pos] == 'E'))
+  {
+    pos++;
+    if (pos < m_size && (m_json[pos] == '+' || m_json[pos] == '-'))
+    {
+      pos++;
+    }
+    if (pos >= m_size || !isDigit(m_json[pos]))
+    {
+      setError(pos);
+      return span;
+    }
+    while (pos < m_size && isDigit(m_json[pos]))
+    {
+      pos++;
+    }
+  }
+
+  span.m_length = pos - span.m_offset;
+  return span;
+}
+
+TextSpan RecursiveJsonParser::parseBoolNull(int &pos, NodeType &type)
+{
+  TextSpan span;
+  span.m_offset = pos;
+  if (startsWith(pos, "true", 4))
+  {
+    type = NodeType::Bool;
+    span.m_length = 4;
+  }
+  else if (startsWith(pos, "false", 5))
+  {
+    type = NodeType::Bool;
+    span.m_length = 5;
+  }
+  else if (startsWith(pos, "null", 4))
+  {
+    type = NodeType::Null;
+    span.m_length = 4;
+  }
+  else
+  {
+    setError(pos);
+  }
+  pos += span.m_length;
+  return span;
+}
+
+int RecursiveJsonParser::parseValue(int pos, int parent, const TextSpan &key)
+{
+  pos = skipWhitespace(pos);
+  if (pos >= m_size)
+  {
+    setError(pos);
+    return pos;
+  }
+
+  char c = m_json[pos];
+  if (c == '{' || c == '[')
+  {
+    return parseContainer(pos, parent, key);
+  }
+
+  NodeType type = NodeType::Null;
+  TextSpan value;
+  if (c == '"')
+  {
+    type = NodeType::String;
+    value = parseString(pos);
+  }
+  else if (isDigit(c) || c == '-')
+  {
+    type = NodeType::Number;
+    value = parseNumber(pos);
+  }
+  else
+  {
+    value = parseBoolNull(pos, type);
+  }
+
+  if (!hasError())
+  {
+    addItem(type, key, value, parent);
+  }
+  return pos;
+}
+
+int RecursiveJsonParser::parseContainer(int pos, int parent, const TextSpan &key)
+{
+  TextSpan value;
+  value.m_offset = pos;
+  bool isObject = m_json[pos] == '{';
+  int id = addItem(isObject ? NodeType::Object : NodeType::Array, key, value, parent);
+  int firstPending = m_pending.size();
+
+  pos = isObject ? parseObject(pos, id) : parseArray(pos, id);
+  if (hasError())
+  {
+    return pos;
+  }
+  m_tree->m_nodes[id].m_value.m_length = pos - value.m_offset;
+  closeContainer(id, firstPending);
+  return pos;
+}
+
+int RecursiveJsonParser::parseObject(int pos, int objId)
+{
+  pos = skipWhitespace(pos + 1);
+  if (pos < m_size && m_json[pos] == '}')
+  {
+    return pos + 1;
+  }
+  while (true)
+  {
+    pos = parseMember(pos, objId);
+    if (hasError())
+    {
+      return pos;
+    }
+
+    pos = skipWhitespace(pos);
+    if (pos < m_size && m_json[pos] == ',')
+    {
+      pos = skipWhitespace(pos + 1);
+      continue;
+    }
+    if (pos < m_size && m_json[pos] == '}')
+    {
+      return pos + 1;
+    }
+    setError(pos);
+    return pos;
+  }
+}
+
+int RecursiveJsonParser::parseMember(int pos, int objId)
+{
+  if (pos >= m_size || m_json[pos] != '"')
+  {
+    setError(pos);
+    return pos;
+  }
+  TextSpan itemKey = parseString(pos);
+  if (hasError())
+  {
+    return pos;
+  }
+
+  pos = skipWhitespace(pos);
+  if (pos >= m_size || m_json[pos] != ':')
+  {
+    setError(pos);
+    return pos;
+  }
+  return parseValue(pos + 1, objId, itemKey);
+}
+
+int RecursiveJsonParser::parseArray(int pos, int arrId)
+{
+  pos = skipWhitespace(pos + 1);
+  if (pos < m_size && m_json[pos] == ']')
+  {
+    return pos + 1;
+  }
+  while (true)
+  {
+    pos = parseValue(pos, arrId);
+    if (hasError())
+    {
+      return pos;
+    }
+
+    pos = skipWhitespace(pos);
+    if (pos < m_size && m_json[pos] == ',')
+    {
+      pos++;
+      continue;
+    }
+    if (pos < m_size && m_json[pos] == ']')
+    {
+      return pos + 1;
+    }
+    setError(pos);
+    return pos;
+  }
+}
@@ -0,0 +1,49 @@
+#ifndef RECURSIVEJSONPARSER_H
+#define RECURSIVEJSONPARSER_H
+
+#include <QByteArray>
+#include "jsonscanner.h"
+#include "jsontree.h"
+
+// Точка отсчета для замеров: разбор JsonParser до перехода на явный стек,
+// каждый уровень вложенности - рекурсивный вызов parseValue/parseContainer.
+// Строит такое же дерево, как последовательный нелениво работающий JsonParser;
+// ленивого режима, параллельного разбора, прогресса и отмены в нем нет.
+// Глубина ограничена только стеком потока.
+// С setBytewise(true) пробелы и строки проверяются побайтно до конца, как до
+// появления JsonScanner, - так замеряется вклад первой стадии на одном разборщике.
+class RecursiveJsonParser
+{
+public:
+  bool parse(const QByteArray &json, JsonTree &tree);
+  int errorOffset() const;
+  void setBytewise(bool bytewise);
+
+private:
+  JsonTree *m_tree = nullptr;
+  const char *m_json = nullptr;
+  int m_size = 0;
+  QVector<int> m_pending;
+  JsonScanner m_scanner;
+  int m_errorOffset = -1;
+  bool m_bytewise = false;
+
+  bool hasError() const;
+  void setError(int pos);
+
+  int addItem(NodeType type, const TextSpan &key, const TextSpan &value, int parent);
+  void closeContainer(int id, int firstPending);
+
+  int parseValue(int pos, int parent, const TextSpan &key = TextSpan());
+  int parseContainer(int pos, int parent, const TextSpan &key);
+  int parseObject(int pos, int objId);
+  int parseMember(int pos, int objId);
+  int parseArray(int pos, int arrId);
+  int skipWhitespace(int pos);
+  bool startsWith(int pos, const char *literal, int length) const;
+  TextSpan parseString(int &pos);
+  TextSpan parseNumber(int &pos);
+  TextSpan parseBoolNull(int &pos, NodeType &type);
+};
+
+#endif // RECURSIVEJSONPARSER_H
@@ -0,0 +1,27 @@
+#ifndef JSONFILTERMODEL_H
+#define JSONFILTERMODEL_H
+
+#include <QSet>
+#include <QSortFilterProxyModel>
+
+// Показывает в дереве только результаты запроса: найденные узлы с их поддеревьями
+// и путь от корня к ним. Узлы JsonModel узнаются по internalId индекса.
+class JsonFilterModel : public QSortFilterProxyModel
+{
+  Q_OBJECT
+
+public:
+  explicit JsonFilterModel(QObject *parent = nullptr);
+
+  void setMatches(const QModelIndexList &matches);
+  void clearMatches();
+
+protected:
+  bool filterAcceptsRow(int sourceRow, const QModelIndex &sourceParent) const override;
+
+private:
+  QSet<quintptr> m_matches;
+  QSet<quintptr> m_ancestors;
+};
+
+#endif // JSONFILTERMODEL_H
@@ -3,30 +3,63 @@
 
 #include <QSyntaxHighlighter>
 #include <QTextCharFormat>
-#include <QJsonObject>
-#include <QJsonDocument>
-#include <QStringList>
-#include <QList>
+#include <QTimer>
+#include <QVector>
+#include "jsonlexer.h"
 
 class JsonHighlighter : public QSyntaxHighlighter
 {
   Q_OBJECT
 
 public:
+  // Full - подсветка всего текста сразу, Deferred - сначала видимая область,
+  // остальное порциями в простое, Plain - подсветка отключена
+  enum Mode
+  {
+    Full,
+    Deferred,
+    Plain
+  };
+
+  static const qint64 kDefaultDeferThreshold = 1 << 20;
+  static const qint64 kDefaultPlainThreshold = 64 << 20;
+
   explicit JsonHighlighter(QTextDocument *parent = nullptr);
 
+  void setDeferThreshold(qint64 bytes);
+  void setPlainThreshold(qint64 bytes);
+  Mode mode() const;
+
+  // Вызывается перед заменой текста документа размером size байт. В режиме Deferred
+  // документ на время замены отсоединяется и подключается уже в attach()
+  Mode prepare(QTextDocument *document, qint64 size);
+  void attach();
+  void setVisibleBlocks(int first, int last);
+  // Время в highlightBlock с прошлого вызова, нс
+  qint64 takeElapsed();
+
+private slots:
+  void highlightSlice();
+
 private:
   void highlightBlock(const QString &text) override;
-
-  void highlightStrings(const QString &text);
-  void highlightStringsKeys(const QString &text);
-  void highlightNumbers(const QString &text);
-  void highlightBooleans(const QString &text);
+  bool shouldFormat(int block) const;
 
   QTextCharFormat m_keyFormat;
   QTextCharFormat m_stringFormat;
   QTextCharFormat m_numberFormat;
   QTextCharFormat m_booleanFormat;
+  QVector<JsonToken> m_tokens;
+
+  Mode m_mode = Full;
+  QTextDocument *m_pending = nullptr;
+  qint64 m_deferThreshold = kDefaultDeferThreshold;
+  qint64 m_plainThreshold = kDefaultPlainThreshold;
+  QTimer m_idleTimer;
+  int m_idleNext = 0;
+  int m_visibleFirst = 0;
+  int m_visibleLast = -1;
+  qint64 m_elapsed = 0;
 };
 
 #endif // JSONHIGHLIGHTER_H
@@ -0,0 +1,41 @@
+#ifndef JSONLEXER_H
+#define JSONLEXER_H
+
+#include <QString>
+#include <QVector>
+
+struct JsonToken
+{
+  enum Kind
+  {
+    Key,
+    String,
+    Number,
+    Literal
+  };
+
+  Kind m_kind;
+  int m_start;
+  int m_length;
+};
+
+// Однопроходный разбор строки текста на лексемы для подсветки.
+// Состояние на конце строки передается в следующую: строковый литерал
+// может продолжаться на нескольких строках документа.
+class JsonLexer
+{
+public:
+  enum State
+  {
+    Normal = 0,
+    InString = 1,
+    InEscape = 2
+  };
+
+  static int tokenize(const QString &text, int state, QVector<JsonToken> &tokens);
+  // Состояние после length байт UTF-8 без разбора на лексемы: с него
+  // можно начать подсветку с середины длинной строки
+  static int scan(const char *data, int length, int state);
+};
+
+#endif // JSONLEXER_H
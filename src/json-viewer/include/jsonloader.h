@@ -0,0 +1,75 @@
+#ifndef JSONLOADER_H
+#define JSONLOADER_H
+
+#include <QAtomicInt>
+#include <QMutex>
+#include <QThread>
+#include "jsonparser.h"
+#include "jsonsearchindex.h"
+#include "loadprofile.h"
+
+// Разбирает JSON в отдельном потоке. Готовое дерево забирается через takeTree()
+// после сигнала treeReady(); в модель его передает уже GUI-поток.
+// JSON Lines разбирается порциями: сначала через takeTree() доступен пустой корень,
+// затем после каждого сигнала recordsReady() - новые записи через takeBatches().
+// Файл больше 2 ГБ (MappedFile::isWindowed()) читается окнами по setWindowBytes() байт,
+// каждое окно кончается на границе строки; индекс поиска для него не строится.
+// После того как дерево отдано, в том же потоке строится индекс поиска; он забирается
+// через takeIndex() после сигнала finished(), до этого поиск недоступен.
+// Время разбора и построения индекса доступно через profile().
+class JsonLoader : public QThread
+{
+  Q_OBJECT
+
+public:
+  explicit JsonLoader(QObject *parent = nullptr);
+  ~JsonLoader();
+
+  void load(const MappedFile &file);
+  void load(const QByteArray &json);
+  void loadLines(const MappedFile &file);
+  void loadLines(const QByteArray &json);
+  void cancel();
+  void setLazy(bool lazy);
+  void setWindowBytes(int bytes);
+
+  bool takeTree(JsonTree &tree);
+  QVector<JsonTree> takeBatches();
+  bool takeIndex(JsonSearchIndex &index);
+  JsonParseError error() const;
+  LoadProfile profile() const;
+  bool wasCanceled() const;
+
+signals:
+  void progressChanged(qint64 bytesDone, qint64 bytesTotal);
+  void recordsReady();
+  void treeReady();
+
+protected:
+  void run() override;
+
+private:
+  mutable QMutex m_mutex;
+  QAtomicInt m_cancel;
+  MappedFile m_file;
+  QByteArray m_json;
+  bool m_fromFile = false;
+  bool m_lines = false;
+  bool m_lazy = false;
+  int m_windowBytes;
+  JsonTree m_tree;
+  QVector<JsonTree> m_batches;
+  JsonSearchIndex m_index;
+  bool m_indexReady = false;
+  LoadProfile m_profile;
+  JsonParseError m_error;
+  bool m_ok = false;
+  bool m_canceled = false;
+
+  void start(const MappedFile &file, const QByteArray &json, bool fromFile, bool lines);
+  void runLines(JsonParser &parser, const MappedFile &file, const QByteArray &source, JsonParseError &error);
+  bool runWindows(JsonParser &parser, const MappedFile &file, JsonParseError &error);
+  bool parseBatches(JsonParser &parser, const QByteArray &source, const TextWindow *window, qint64 total);
+};
+
+#endif // JSONLOADER_H
@@ -2,20 +2,10 @@
 #define JSONMODEL_H
 
 #include <QAbstractItemModel>
-#include <QVector>
 #include <QString>
-
-struct Node
-{
-  QString m_text;
-  Node *m_parent = nullptr;
-  QVector<Node*> m_children;
-
-  ~Node()
-  {
-    qDeleteAll(m_children);
-  }
-};
+#include <functional>
+#include "jsonquery.h"
+#include "jsontree.h"
 
 class JsonModel : public QAbstractItemModel
 {
@@ -26,6 +16,30 @@ public:
   ~JsonModel();
 
   bool loadJson(const QByteArray &json);
+  bool loadFile(const MappedFile &file);
+  void setTree(JsonTree tree);
+  void appendRecords(const JsonTree &batch);
+  // Частичное обновление после правки текста. Модель перестает ссылаться на отображение
+  // файла, поэтому представления текста должны перейти на json раньше.
+  // replaced получает разобранный заново участок прежнего текста (m_offset -1, если текст
+  // не изменился); в новом тексте он длиннее на разницу размеров
+  bool updateSource(const QByteArray &json, TextSpan *replaced = nullptr);
+  void fetchAll();
+  QModelIndex locate(int offset);
+  QModelIndexList query(const JsonQuery &query);
+
+  // Раскрытие веток: счетчики ведутся по сигналам представления,
+  // поэтому проверка "все раскрыто" не обходит дерево
+  void setExpanded(const QModelIndex &index, bool expanded);
+  void setAllExpanded(bool expanded);
+  bool allExpanded() const;
+  int expandableCount() const;
+  int expandedCount() const;
+  const QByteArray &source() const;
+  const MappedFile &file() const;
+  qint64 sourceSize() const;
+  int nodeCount() const;
+  qint64 memoryUsage() const;
     
   bool hasElement(const QModelIndex &parent, const QString &text) const;
 
@@ -35,21 +49,33 @@ public:
   QModelIndex parent(const QModelIndex &index) const override;
   int rowCount(const QModelIndex &parent = QModelIndex()) const override;
   int columnCount(const QModelIndex &parent = QModelIndex()) const override;
+  bool hasChildren(const QModelIndex &parent = QModelIndex()) const override;
+  bool canFetchMore(const QModelIndex &parent) const override;
+  void fetchMore(const QModelIndex &parent) override;
   QModelIndex rootIndex() const;
   void clear();
 
 private:
-  Node *m_root;
-  Node* getNode(const QModelIndex &index) const;
-  void addItem(const QString &text, const QModelIndex &parent);
-
-  int parseValue(const QString &json, int pos, const QModelIndex &parent, const QString &key = QString());
-  int parseObject(const QString &json, int pos, const QModelIndex &parent, const QString &key = QString());
-  int parseArray(const QString &json, int pos, const QModelIndex &parent, const QString &key = QString());
-  int skipWhitespace(const QString &json, int pos);
-  QString parseString(const QString &json, int &pos);
-  QString parseNumber(const QString &json, int &pos);
-  QString parseBoolNull(const QString &json, int &pos);
+  JsonTree m_tree;
+  int m_expandableCount = 0;
+  int m_expandedCount = 0;
+  quint16 m_expandEpoch = 1;
+  int m_deadNodes = 0;
+  int m_deadChildIds = 0;
+  mutable QVector<QString> m_keyText;
+
+  int nodeId(const QModelIndex &index) const;
+  QModelIndex indexOf(int id) const;
+  int extentStart(int id) const;
+  int extentEnd(int id) const;
+  int enclosingContainer(int begin, int end) const;
+  bool isExpanded(const Node &node) const;
+  void setChildren(int id, const QVector<int> &ids);
+  void shiftSpans(int id, int firstRow, int delta);
+  void visitSubtree(int id, const std::function<void(int)> &visit);
+  void trackSubtree(int id, bool added);
+  QString displayText(const QModelIndex &index) const;
+  QString keyText(int id) const;
 };
 
 #endif // JSONMODEL_H
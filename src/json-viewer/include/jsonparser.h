@@ -0,0 +1,123 @@
+#ifndef JSONPARSER_H
+#define JSONPARSER_H
+
+#include <QAtomicInt>
+#include <QByteArray>
+#include <QString>
+#include <QVector>
+#include <functional>
+#include "jsonscanner.h"
+#include "jsontree.h"
+
+struct JsonChunk;
+
+// Открытый контейнер в стеке разбора: узел, начало в тексте и первый из его детей в m_pending.
+struct ContainerFrame
+{
+  int m_id = -1;
+  int m_offset = 0;
+  int m_firstPending = 0;
+  bool m_object = false;
+  bool m_deferred = false;
+};
+
+// Описание ошибки разбора. m_offset - смещение в байтах, m_line и m_column считаются с 1.
+// m_offset == -1 означает, что ошибки нет.
+struct JsonParseError
+{
+  QString m_message;
+  int m_offset = -1;
+  int m_line = 0;
+  int m_column = 0;
+};
+
+// Парсер, сохраняющий порядок ключей. Заполняет JsonTree без участия модели,
+// поэтому разбор не порождает сигналов QAbstractItemModel. Работает прямо по байтам UTF-8:
+// строки декодируются только при отображении. Длинные пробелы и тела строк пропускаются
+// по маскам JsonScanner, остальная грамматика проверяется посимвольно.
+// Вложенные контейнеры разбираются циклом по явному стеку без рекурсии,
+// глубина вложенности ограничена setMaxDepth().
+// Разбор строгий: за один проход проверяется вся грамматика JSON, при ошибке
+// дерево остается пустым, а место ошибки доступно через error().
+// Для фоновой загрузки парсер периодически сообщает о прогрессе и проверяет флаг отмены.
+// В ленивом режиме узлы строятся только для корня и его детей, содержимое остальных
+// контейнеров лишь проверяется; materialize() достраивает один уровень по запросу модели.
+// Большой корневой массив или объект делится по запятым первого уровня на части,
+// которые разбираются параллельно в отдельные деревья и затем склеиваются по порядку.
+// JSON Lines читается порциями: parseLines() разбирает очередные строки в отдельное
+// дерево, которое appendPart() дописывает к корню, созданному startLines().
+// parseRange() разбирает измененный участок между соседними элементами контейнера
+// для частичного обновления модели.
+class JsonParser
+{
+public:
+  static const int kDefaultMaxDepth = 100000;
+
+  bool parse(const QByteArray &json, JsonTree &tree);
+  bool parse(const MappedFile &file, JsonTree &tree);
+  bool materialize(JsonTree &tree, int id);
+
+  static void startLines(const QByteArray &source, JsonTree &tree);
+  // Текст строкового литерала (без кавычек) с раскрытыми escape-последовательностями
+  static QString decodeString(const char *data, int length);
+  bool parseLines(const QByteArray &source, int &pos, int maxBytes, JsonTree &batch);
+  static void appendPart(JsonTree &tree, const JsonTree &part, int parentId, QVector<int> &rootChildren);
+  bool parseRange(const QByteArray &source, int begin, int end, NodeType type,
+                  bool leadingComma, bool trailingComma, JsonTree &part);
+
+  void setLazy(bool lazy);
+  void setThreadCount(int count);
+  void setMaxDepth(int depth);
+  const JsonParseError &error() const;
+  bool wasCanceled() const;
+
+  void setCancelFlag(const QAtomicInt *flag);
+  void setProgressHandler(const std::function<void(qint64, qint64)> &handler);
+
+private:
+  JsonTree *m_tree = nullptr;
+  const char *m_json = nullptr;
+  int m_size = 0;
+  QVector<int> m_pending;
+  QVector<ContainerFrame> m_stack;
+  JsonScanner m_scanner;
+  JsonParseError m_error;
+  const QAtomicInt *m_cancelFlag = nullptr;
+  std::function<void(qint64, qint64)> m_progressHandler;
+  int m_nextCheckpoint = 0;
+  bool m_canceled = false;
+  bool m_lazy = false;
+  int m_skipDepth = 0;
+  int m_threadCount = 0;
+  int m_maxDepth = kDefaultMaxDepth;
+  int m_depthBase = 0;
+
+  bool hasError() const;
+  void setError(int pos, const QString &message);
+  bool checkpoint(int pos);
+
+  int addItem(NodeType type, const TextSpan &key, const TextSpan &value, int parent);
+  void closeContainer(int id, int firstPending);
+
+  int parseValue(int pos, int parent, const TextSpan &key = TextSpan());
+  int parseScalar(int pos, int parent, const TextSpan &key);
+  int openContainer(int pos, int parent, const TextSpan &key);
+  int closeFrame(int pos);
+  int parseContainers(int pos, int depth);
+  int parseKey(int pos, TextSpan &key);
+  int parseMember(int pos, int objId);
+  int skipWhitespace(int pos);
+  bool startsWith(int pos, const char *literal, int length) const;
+  TextSpan parseString(int &pos);
+  TextSpan parseNumber(int &pos);
+  TextSpan parseBoolNull(int &pos, NodeType &type);
+
+  bool parseParallel(int rootPos);
+  QVector<int> splitTopLevel(int rootPos, int chunkCount, int &rootEnd);
+  bool parseChunk(const QByteArray &source, int begin, int end, NodeType type, JsonTree &tree);
+  void stitchChunks(QVector<JsonChunk> &chunks, NodeType type, int rootPos, int rootEnd);
+
+  friend class JsonChunkTask;
+};
+
+#endif // JSONPARSER_H
@@ -0,0 +1,69 @@
+#ifndef JSONQUERY_H
+#define JSONQUERY_H
+
+#include <QByteArray>
+#include <QString>
+#include <QVector>
+#include <functional>
+#include "jsontree.h"
+
+// Шаг скомпилированного запроса. Token - шаг JSON Pointer: ключ для объекта, индекс для массива.
+// m_descendants - шаг применяется ко всем потомкам (".." в JSONPath).
+struct QueryStep
+{
+  enum Kind
+  {
+    Key,
+    Index,
+    Slice,
+    Wildcard,
+    Token
+  };
+
+  Kind m_kind = Key;
+  QByteArray m_key;
+  int m_index = 0;
+  int m_end = 0;
+  bool m_descendants = false;
+};
+
+// Запрос к дереву: JSONPath ($.items[*].status, $..id, $['a b'][0], $.list[1:3])
+// или JSON Pointer (/items/0/status). Выражение разбирается один раз в список шагов,
+// затем вычисляется по узлам дерева: ключи объектов сравниваются с ключами таблицы дерева
+// после раскрытия escape ("a\u0062" совпадает с ключом ab), элементы массивов берутся по индексу напрямую.
+// Фильтры JSONPath (?()) и объединения не поддерживаются.
+class JsonQuery
+{
+public:
+  bool compile(const QString &expression);
+  bool isValid() const;
+  const QString &errorString() const;
+  // Запрос обходит потомков (".."): перед ним дерево выгоднее достроить целиком.
+  bool hasDescendants() const;
+
+  // load(id) вызывается перед обходом детей узла, чтобы достроить отложенный контейнер.
+  QVector<int> evaluate(const JsonTree &tree, const std::function<void(int)> &load) const;
+
+private:
+  // Ключи таблицы дерева, совпадающие с ключом шага. Таблица растет при ленивой загрузке,
+  // поэтому новые ключи досматриваются по мере обхода.
+  struct KeyMatch
+  {
+    QByteArray m_key;
+    QString m_text;
+    QVector<bool> m_matches;
+  };
+
+  QVector<QueryStep> m_steps;
+  QString m_error;
+  bool m_valid = false;
+
+  bool compilePointer(const QByteArray &expression);
+  bool compilePath(const QByteArray &expression);
+  bool setError(const QString &message, int pos);
+  void apply(const JsonTree &tree, const QueryStep &step, int id, KeyMatch &match, QVector<int> &result) const;
+  void appendMembers(const JsonTree &tree, int id, KeyMatch &match, QVector<int> &result) const;
+  static bool matchesKey(const KeyMatch &match, const char *key, int length);
+};
+
+#endif // JSONQUERY_H
@@ -0,0 +1,66 @@
+#ifndef JSONSCANNER_H
+#define JSONSCANNER_H
+
+#include <QtGlobal>
+
+// Битовые маски одного блока из 64 байт: бит i относится к байту блока с номером i.
+// m_structural - скобки и запятые, без учета того, внутри строки они или нет.
+struct ScanBlock
+{
+  quint64 m_whitespace = 0;
+  quint64 m_quote = 0;
+  quint64 m_backslash = 0;
+  quint64 m_control = 0;
+  quint64 m_structural = 0;
+};
+
+// Первая стадия разбора: классифицирует вход блоками по 64 байта (SSE2/AVX2, если
+// процессор их поддерживает, иначе скалярно) и кэширует маски недавних блоков.
+// Парсер по маскам перескакивает длинные пробелы и тела строк целыми словами.
+// Байты за концом данных считаются управляющими символами, поэтому skipWhitespace и
+// findStringSpecial на них останавливаются; findStructuralOrQuote сверяется с размером.
+class JsonScanner
+{
+public:
+  enum Level
+  {
+    Scalar,
+    Sse2,
+    Avx2
+  };
+
+  void reset(const char *data, int size);
+
+  int skipWhitespace(int pos);
+  int findStringSpecial(int pos);
+  int findStructuralOrQuote(int pos);
+
+  static Level bestLevel();
+  static Level level();
+  static void setLevel(Level level);
+  static void classify(const char *data, int size, ScanBlock &block);
+
+private:
+  // Кэш масок с прямым отображением: блок i хранится в ячейке i % kCacheBlocks.
+  // Блок классифицируется только при первом обращении, 256 блоков помещаются в L1.
+  static const int kCacheBlocks = 256;
+
+  const char *m_data = nullptr;
+  int m_size = 0;
+  int m_tags[kCacheBlocks];
+  ScanBlock m_cache[kCacheBlocks];
+
+  void fillBlock(int index);
+
+  const ScanBlock &block(int index)
+  {
+    int slot = index & (kCacheBlocks - 1);
+    if (m_tags[slot] != index)
+    {
+      fillBlock(index);
+    }
+    return m_cache[slot];
+  }
+};
+
+#endif // JSONSCANNER_H
@@ -0,0 +1,45 @@
+#ifndef JSONSEARCHINDEX_H
+#define JSONSEARCHINDEX_H
+
+#include <QByteArray>
+#include <QHash>
+#include <QVector>
+
+// Индекс полнотекстового поиска по ключам и скалярным значениям документа.
+// Строится одним проходом по исходному тексту, поэтому не зависит от того,
+// построены ли узлы дерева (ленивая загрузка). Одинаковые токены хранятся один раз,
+// для каждого - список смещений вхождений; по триграммам различных токенов
+// быстро отбираются кандидаты для поиска подстроки.
+// Поиск без учета регистра латиницы, по тексту как он записан в JSON (escape не раскрываются).
+// Введенный пользователем текст приводится к записи в строке JSON через escaped(): так находятся
+// кавычки, обратная косая черта и управляющие символы. Необязательные escape (\uXXXX вместо
+// символа, \/) не сопоставляются - такой текст ищется в том виде, как он записан в файле.
+class JsonSearchIndex
+{
+public:
+  void build(const QByteArray &source);
+  // Частичное обновление после правки: участок [begin, oldEnd) прежнего текста заменен
+  // участком [begin, newEnd) source. Вхождения участка заменяются токенами нового текста,
+  // смещения после него сдвигаются. Границы участка должны лежать между элементами,
+  // вне строк и токенов, как у участка, который заново разбирает JsonModel::updateSource()
+  void update(const QByteArray &source, int begin, int oldEnd, int newEnd);
+  void clear();
+  bool isEmpty() const;
+  int tokenCount() const;
+
+  // Смещения в байтах начала найденных токенов (для строк - первый символ после кавычки), по возрастанию.
+  QVector<int> find(const QByteArray &text) const;
+  // Текст UTF-8 в записи строки JSON, без окружающих кавычек.
+  static QByteArray escaped(const QByteArray &text);
+
+private:
+  QVector<QByteArray> m_tokens;
+  QVector<int> m_firstOccurrence;
+  QVector<int> m_occurrences;
+  QHash<quint32, QVector<int>> m_trigrams;
+
+  int findToken(const QByteArray &token) const;
+  void addTrigrams(int id);
+};
+
+#endif // JSONSEARCHINDEX_H
@@ -0,0 +1,277 @@
+#ifndef JSONTREE_H
+#define JSONTREE_H
+
+#include <QByteArray>
+#include <QHash>
+#include <QVector>
+#include <cstring>
+#include "mappedfile.h"
+
+enum class NodeType : quint8
+{
+  Object,
+  Array,
+  String,
+  Number,
+  Bool,
+  Null
+};
+
+// Фрагмент исходного текста: смещение и длина в байтах JsonTree::sourceOf() узла (UTF-8).
+struct TextSpan
+{
+  int m_offset = -1;
+  int m_length = 0;
+};
+
+// Таблица различных ключей объектов документа. Узел хранит id ключа, поэтому
+// одинаковые ключи записей хранятся один раз и сравниваются как целые числа.
+// Ключи хранятся как записаны в источнике, escape-последовательности не раскрываются.
+// Записи массива обычно повторяют ключи в одном порядке: сначала проверяется ключ,
+// который в прошлый раз шел за предыдущим, и только при промахе - поиск в хеше.
+// Таблица ограничена kMaxKeys ключами: в словаре с уникальными ключами каждый новый ключ
+// стоил бы памяти сверх узла, поэтому после заполнения новые ключи не запоминаются
+// (kNotInterned), их текст берется из источника.
+class JsonKeyTable
+{
+public:
+  static const int kMaxKeys = 4096;
+  static const int kNotInterned = -2;
+
+  int intern(const char *data, int length)
+  {
+    if (m_last >= 0)
+    {
+      int guess = m_successors.at(m_last);
+      if (guess >= 0 && m_keys.at(guess).size() == length && std::memcmp(m_keys.at(guess).constData(), data, size_t(length)) == 0)
+      {
+        m_last = guess;
+        return guess;
+      }
+    }
+    int id = m_ids.value(QByteArray::fromRawData(data, length), -1);
+    if (id < 0 && m_keys.size() >= kMaxKeys)
+    {
+      m_last = -1;
+      return kNotInterned;
+    }
+    if (id < 0)
+    {
+      id = m_keys.size();
+      QByteArray key(data, length);
+      m_keys.append(key);
+      m_ids.insert(key, id);
+      m_successors.append(-1);
+    }
+    if (m_last >= 0)
+    {
+      m_successors[m_last] = id;
+    }
+    m_last = id;
+    return id;
+  }
+
+  int find(const QByteArray &key) const
+  {
+    return m_ids.value(key, -1);
+  }
+
+  int size() const
+  {
+    return m_keys.size();
+  }
+
+  const QByteArray &key(int id) const
+  {
+    return m_keys.at(id);
+  }
+
+  // Переносит ключи другой таблицы; результат - новые id по старым (kNotInterned, если таблица заполнена)
+  QVector<int> merge(const JsonKeyTable &other)
+  {
+    QVector<int> ids;
+    ids.reserve(other.size());
+    for (const QByteArray &key : other.m_keys)
+    {
+      ids.append(intern(key.constData(), key.size()));
+    }
+    return ids;
+  }
+
+  qint64 memoryUsage() const
+  {
+    qint64 bytes = qint64(m_keys.capacity()) * qint64(sizeof(QByteArray) * 2 + sizeof(int) * 3);
+    for (const QByteArray &key : m_keys)
+    {
+      bytes += key.size();
+    }
+    return bytes;
+  }
+
+private:
+  QVector<QByteArray> m_keys;
+  QHash<QByteArray, int> m_ids;
+  QVector<int> m_successors;
+  int m_last = -1;
+};
+
+// Узел хранится в общем массиве дерева и ссылается на соседей по индексам.
+// Дочерние узлы контейнера лежат подряд в m_childIds: [m_firstChild, m_firstChild + m_childCount),
+// m_row - позиция узла среди детей родителя, чтобы parent() не искал ее перебором.
+// Текст узла не хранится: data() собирает его из ключа и m_value по исходному тексту.
+// Ключ - id в таблице ключей дерева (-1 - узел без ключа, JsonKeyTable::kNotInterned - ключ не
+// попал в таблицу); сам ключ в тексте стоит прямо перед значением, его находит JsonTree::keySpan().
+// m_firstChild == -1 - дети контейнера еще не построены (ленивая загрузка), m_childCount при этом известен.
+// m_expandEpoch - узел раскрыт в представлении, если совпадает с эпохой JsonModel; поле ведет модель,
+// оно занимает выравнивание после m_type, а свернуть все можно сменой эпохи без обхода узлов.
+struct Node
+{
+  int m_parent = -1;
+  int m_row = 0;
+  int m_firstChild = 0;
+  int m_childCount = 0;
+  int m_keyId = -1;
+  TextSpan m_value;
+  NodeType m_type = NodeType::Null;
+  quint16 m_expandEpoch = 0;
+
+  bool childrenLoaded() const
+  {
+    return m_firstChild >= 0;
+  }
+
+  bool hasKey() const
+  {
+    return m_keyId != -1;
+  }
+};
+
+// Окно файла JSON Lines больше 2 ГБ: байты окна, его позиция в файле
+// и первая запись, разобранная из окна.
+struct TextWindow
+{
+  qint64 m_filePos = 0;
+  int m_firstRecord = 0;
+  QByteArray m_bytes;
+};
+
+// Разобранный документ: исходный текст и узлы. Строится парсером отдельно от модели
+// и передается в JsonModel целиком. Корень, если он есть, - узел 0.
+// Если документ открыт из файла, m_source ссылается на отображение m_file без копии.
+// Для JSON Lines (m_lines) корень - массив записей, которые дописываются порциями,
+// поэтому id записей хранятся отдельно в m_records, а не в m_childIds.
+// Большой файл JSON Lines читается окнами (m_windows не пуст, m_source пуст): смещения
+// узлов записи отсчитываются от начала ее окна, текст узла дает sourceOf().
+// Порция, разобранная из окна, несет в m_windows одно это окно.
+struct JsonTree
+{
+  QByteArray m_source;
+  MappedFile m_file;
+  QVector<Node> m_nodes;
+  QVector<int> m_childIds;
+  QVector<int> m_records;
+  QVector<TextWindow> m_windows;
+  JsonKeyTable m_keys;
+  bool m_lines = false;
+
+  bool isEmpty() const
+  {
+    return m_nodes.isEmpty();
+  }
+
+  // Память под узлы и списки детей в байтах, по выделенной емкости; исходный текст не учитывается
+  qint64 memoryUsage() const
+  {
+    return qint64(m_nodes.capacity()) * qint64(sizeof(Node)) +
+        qint64(m_childIds.capacity() + m_records.capacity()) * qint64(sizeof(int)) + m_keys.memoryUsage();
+  }
+
+  // Ключ узла id в sourceOf(id) без кавычек. Между ключом и значением только двоеточие и пробелы,
+  // поэтому ключ находится обратным просмотром от значения; длину дает таблица ключей,
+  // а для ключа вне таблицы - поиск открывающей кавычки, не экранированной обратной косой чертой
+  TextSpan keySpan(int id) const
+  {
+    TextSpan span;
+    const Node &node = m_nodes.at(id);
+    if (!node.hasKey())
+    {
+      return span;
+    }
+    const char *text = sourceOf(id).constData();
+    int quote = node.m_value.m_offset - (node.m_type == NodeType::String ? 2 : 1);
+    while (text[quote] != ':')
+    {
+      --quote;
+    }
+    do
+    {
+      --quote;
+    }
+    while (text[quote] != '"');
+    if (node.m_keyId >= 0)
+    {
+      span.m_length = m_keys.key(node.m_keyId).size();
+    }
+    else
+    {
+      auto escaped = [text](int pos)
+      {
+        int slashes = 0;
+        while (text[pos - slashes - 1] == '\\')
+        {
+          ++slashes;
+        }
+        return slashes % 2 == 1;
+      };
+      int begin = quote - 1;
+      while (text[begin] != '"' || escaped(begin))
+      {
+        --begin;
+      }
+      span.m_length = quote - begin - 1;
+    }
+    span.m_offset = quote - span.m_length;
+    return span;
+  }
+
+  // Текст, к которому относятся смещения узла id
+  const QByteArray &sourceOf(int id) const
+  {
+    if (m_windows.isEmpty() || id <= 0)
+    {
+      return m_source;
+    }
+    // Запись - предок узла прямо под корнем; окна упорядочены по первой записи
+    while (m_nodes.at(id).m_parent > 0)
+    {
+      id = m_nodes.at(id).m_parent;
+    }
+    int row = m_nodes.at(id).m_row;
+    int low = 0;
+    int high = m_windows.size() - 1;
+    while (low < high)
+    {
+      int mid = (low + high + 1) / 2;
+      if (m_windows.at(mid).m_firstRecord <= row)
+      {
+        low = mid;
+      }
+      else
+      {
+        high = mid - 1;
+      }
+    }
+    return m_windows.at(low).m_bytes;
+  }
+
+  int childId(int parentId, int row) const
+  {
+    if (parentId == 0 && m_lines)
+    {
+      return m_records.at(row);
+    }
+    return m_childIds.at(m_nodes.at(parentId).m_firstChild + row);
+  }
+};
+
+#endif // JSONTREE_H
@@ -0,0 +1,64 @@
+#ifndef LARGETEXTVIEW_H
+#define LARGETEXTVIEW_H
+
+#include <QAbstractScrollArea>
+#include <QByteArray>
+#include <QColor>
+#include <QHash>
+#include <QVector>
+#include "jsonlexer.h"
+#include "mappedfile.h"
+#include "textlineindex.h"
+
+// Просмотр большого текста только для чтения. Документ не копируется:
+// строки берутся из исходных байтов (для файла - из его отображения в память,
+// копия MappedFile удерживает отображение, пока текст показан)
+// и рисуются только для видимой области, включая видимые столбцы длинной строки
+// (столбец - байт строки, для многобайтовых символов положение приблизительное). Выделяются целые строки (Shift
+// расширяет выделение), правка фрагмента запрашивается двойным щелчком
+// по строке или из контекстного меню для всего выделения.
+class LargeTextView : public QAbstractScrollArea
+{
+  Q_OBJECT
+
+public:
+  explicit LargeTextView(QWidget *parent = nullptr);
+
+  void setSource(const QByteArray &source, const MappedFile &file = MappedFile());
+  void clear();
+  const QByteArray &source() const;
+  void showOffset(int offset);
+
+signals:
+  // Байтовый диапазон выделенных строк, без перевода строки в конце
+  void editRequested(int begin, int end);
+
+protected:
+  void paintEvent(QPaintEvent *event) override;
+  void resizeEvent(QResizeEvent *event) override;
+  void mousePressEvent(QMouseEvent *event) override;
+  void mouseMoveEvent(QMouseEvent *event) override;
+  void mouseDoubleClickEvent(QMouseEvent *event) override;
+  void contextMenuEvent(QContextMenuEvent *event) override;
+
+private:
+  void updateScrollBars();
+  void requestEdit();
+  int lineAtY(int y) const;
+  QColor tokenColor(JsonToken::Kind kind) const;
+  int lexState(int line, int offset);
+
+  QByteArray m_source;
+  MappedFile m_file;
+  TextLineIndex m_lines;
+  QVector<JsonToken> m_tokens;
+  // Состояния лексера через каждые kStateStep байт длинных строк
+  QHash<int, QVector<quint8>> m_lineStates;
+  int m_lineHeight = 1;
+  int m_charWidth = 1;
+  int m_anchorLine = -1;
+  int m_selFirst = -1;
+  int m_selLast = -1;
+};
+
+#endif // LARGETEXTVIEW_H
@@ -0,0 +1,67 @@
+#ifndef LOADPROFILE_H
+#define LOADPROFILE_H
+
+#include <QElapsedTimer>
+#include <QString>
+#include <QVector>
+
+// Замеры одной загрузки документа: время этапов и счетчики (байты, узлы, память).
+// Этапы именуются короткими ключами ("parse", "model"), они же попадают в журнал.
+// Повторный замер этапа с тем же ключом суммируется.
+class LoadProfile
+{
+public:
+  // Итог загрузки: замер выводится и для прерванной загрузки
+  enum Status
+  {
+    Ok,
+    Error,
+    Canceled
+  };
+
+  // Замеряет время от создания до разрушения и добавляет его к этапу
+  class Scope
+  {
+  public:
+    Scope(LoadProfile &profile, const char *phase);
+    ~Scope();
+
+  private:
+    LoadProfile &m_profile;
+    const char *m_phase;
+    QElapsedTimer m_timer;
+  };
+
+  void clear();
+  bool isEmpty() const;
+  void addTime(const char *phase, qint64 ns);
+  void setCounter(const char *name, qint64 value);
+  void setStatus(Status status);
+  Status status() const;
+  // Неудачный итог другого замера переносится в этот
+  void merge(const LoadProfile &other);
+  qint64 time(const char *phase) const;
+  qint64 counter(const char *name) const;
+  qint64 totalTime() const;
+
+  // Краткая сводка для строки состояния
+  QString summary() const;
+  // Одна строка key=value для журнала
+  QString logLine() const;
+
+private:
+  struct Entry
+  {
+    const char *m_name;
+    qint64 m_value;
+  };
+
+  QVector<Entry> m_phases;
+  QVector<Entry> m_counters;
+  Status m_status = Ok;
+
+  static qint64 *find(QVector<Entry> &entries, const char *name);
+  static qint64 value(const QVector<Entry> &entries, const char *name);
+};
+
+#endif // LOADPROFILE_H
@@ -8,8 +8,16 @@
 #include <QTextStream>
 #include <QDebug>
 #include <QStringList>
+#include <QStackedWidget>
 #include "jsonhighlighter.h"
 #include "jsonmodel.h"
+#include "jsonparser.h"
+#include "jsonfiltermodel.h"
+#include "jsonloader.h"
+#include "jsonsearchindex.h"
+#include "largetextview.h"
+#include "loadprofile.h"
+#include "mappedfile.h"
 
 QT_BEGIN_NAMESPACE
 namespace Ui { class MainWindow; }
@@ -29,15 +37,46 @@ private slots:
   void on_showButton_clicked();
   void on_jsonTreeView_collapsed(const QModelIndex &index);
   void on_jsonTreeView_expanded(const QModelIndex &index);
+  void on_cancelButton_clicked();
+  void onLoadProgress(qint64 bytesDone, qint64 bytesTotal);
+  void onLoadFinished();
+  void onRecordsReady();
+  void onTreeReady();
+  void on_searchEdit_textChanged(const QString &text);
+  void on_searchEdit_returnPressed();
+  void on_searchNextButton_clicked();
+  void on_searchPrevButton_clicked();
+  void on_queryEdit_returnPressed();
+  void updateVisibleBlocks();
+  void onTextEditRequested(int begin, int end);
 
 private:
-  void expandAll(const QModelIndex &index);
-  void collapseAll(const QModelIndex &index);
-  bool isTreeExpanded(const QModelIndex &index);
-  bool isTreeCollapsed(const QModelIndex &index);
+  void updateShowButton();
+  void showSearchHit(int step);
+  void setTreeModel(QAbstractItemModel *model);
+  QModelIndex toSource(const QModelIndex &index) const;
+  QModelIndex toView(const QModelIndex &index) const;
+  void showParseError(const JsonParseError &error);
+  void setLoading(bool loading);
+  void setSourceText(const QByteArray &source, const MappedFile &file = MappedFile());
+  bool updateModelSource(const QByteArray &text);
+  void setSourceTextProfiled(const QByteArray &source, const MappedFile &file = MappedFile());
+  void reportProfile(bool modelLoaded);
 
   Ui::MainWindow *ui;
   JsonHighlighter m_highlighter;
   JsonModel m_model;
+  JsonFilterModel m_filter;
+  LargeTextView *m_largeView = nullptr;
+  QStackedWidget *m_textStack = nullptr;
+  JsonLoader m_loader;
+  bool m_loadingFile = false;
+  bool m_linesMode = false;
+  bool m_windowed = false;
+  JsonSearchIndex m_searchIndex;
+  bool m_searchIndexValid = false;
+  QVector<int> m_searchHits;
+  int m_searchPos = -1;
+  LoadProfile m_profile;
 };
 #endif // MAINWINDOW_H
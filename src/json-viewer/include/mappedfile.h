@@ -0,0 +1,36 @@
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+#include <QByteArray>
+#include <QFile>
+#include <QSharedPointer>
+#include <QString>
+
+// Файл, отображенный в память только для чтения. Копии разделяют одно отображение,
+// которое освобождается вместе с последней копией, поэтому JsonTree может ссылаться
+// на страницы файла без копирования.
+// Файл больше 2 ГБ (или открытый с windowed) целиком не отображается: bytes() для него пуст,
+// а содержимое читается окнами через window() по 64-битным позициям. Окна живут,
+// пока жива хотя бы одна копия объекта.
+class MappedFile
+{
+public:
+  bool open(const QString &fileName, bool windowed = false);
+  void close();
+
+  QByteArray bytes() const;
+  QByteArray window(qint64 offset, int size) const;
+  bool isWindowed() const;
+  qint64 size() const;
+  QString fileName() const;
+  QString errorString() const;
+
+private:
+  QSharedPointer<QFile> m_file;
+  const char *m_data = nullptr;
+  qint64 m_size = 0;
+  bool m_windowed = false;
+  QString m_error;
+};
+
+#endif // MAPPEDFILE_H
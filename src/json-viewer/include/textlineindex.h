@@ -0,0 +1,29 @@
+#ifndef TEXTLINEINDEX_H
+#define TEXTLINEINDEX_H
+
+#include <QByteArray>
+#include <QVector>
+
+// Смещения начала строк текста. Позволяет показать любую строку
+// большого файла без разбора всего, что перед ней. Индекс ссылается
+// на данные текста, текст должен жить не меньше индекса.
+class TextLineIndex
+{
+public:
+  void build(const QByteArray &text);
+  void clear();
+  int lineCount() const;
+  int lineStart(int line) const;
+  // Конец строки без перевода строки (\n или \r\n)
+  int lineEnd(int line) const;
+  int lineAt(int offset) const;
+  int maxLineLength() const;
+
+private:
+  const char *m_data = nullptr;
+  int m_size = 0;
+  int m_maxLineLength = 0;
+  QVector<int> m_starts;
+};
+
+#endif // TEXTLINEINDEX_H
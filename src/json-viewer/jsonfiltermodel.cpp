@@ -0,0 +1,47 @@
+#include "jsonfiltermodel.h"
+
+JsonFilterModel::JsonFilterModel(QObject *parent) : QSortFilterProxyModel(parent)
+{
+}
+
+void JsonFilterModel::setMatches(const QModelIndexList &matches)
+{
+  m_matches.clear();
+  m_ancestors.clear();
+  for (const QModelIndex &match : matches)
+  {
+    m_matches.insert(match.internalId());
+    // Общие предки добавляются один раз: подъем останавливается на уже известном
+    for (QModelIndex parent = match.parent(); parent.isValid(); parent = parent.parent())
+    {
+      if (m_ancestors.contains(parent.internalId()))
+      {
+        break;
+      }
+      m_ancestors.insert(parent.internalId());
+    }
+  }
+  invalidateFilter();
+}
+
+void JsonFilterModel::clearMatches()
+{
+  setMatches(QModelIndexList());
+}
+
+bool JsonFilterModel::filterAcceptsRow(int sourceRow, const QModelIndex &sourceParent) const
+{
+  quintptr id = sourceModel()->index(sourceRow, 0, sourceParent).internalId();
+  if (m_matches.contains(id) || m_ancestors.contains(id))
+  {
+    return true;
+  }
+  for (QModelIndex parent = sourceParent; parent.isValid(); parent = parent.parent())
+  {
+    if (m_matches.contains(parent.internalId()))
+    {
+      return true;
+    }
+  }
+  return false;
+}
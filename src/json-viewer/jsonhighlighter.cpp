@@ -1,4 +1,17 @@
 #include "jsonhighlighter.h"
+#include <QElapsedTimer>
+#include <QTextDocument>
+
+namespace
+{
+  // Длительность одной порции фоновой подсветки, мс
+  const int kSliceTime = 10;
+  // Сколько строк от начала подсвечивается сразу после загрузки
+  const int kInitialBlocks = 200;
+}
+
+const qint64 JsonHighlighter::kDefaultDeferThreshold;
+const qint64 JsonHighlighter::kDefaultPlainThreshold;
 
 JsonHighlighter::JsonHighlighter(QTextDocument *parent) : QSyntaxHighlighter(parent)
 {
@@ -7,56 +20,157 @@ JsonHighlighter::JsonHighlighter(QTextDocument *parent) : QSyntaxHighlighter(par
   m_stringFormat.setForeground(Qt::darkGreen);
   m_numberFormat.setForeground(Qt::darkRed);
   m_booleanFormat.setForeground(Qt::darkYellow);
+
+  m_idleTimer.setInterval(0);
+  connect(&m_idleTimer, &QTimer::timeout, this, &JsonHighlighter::highlightSlice);
 }
 
-void JsonHighlighter::highlightBlock(const QString &text)
+void JsonHighlighter::setDeferThreshold(qint64 bytes)
 {
-  highlightNumbers(text);
-  highlightBooleans(text);
-  highlightStrings(text);
-  highlightStringsKeys(text);
+  m_deferThreshold = bytes;
 }
 
-void JsonHighlighter::highlightStrings(const QString &text)
+void JsonHighlighter::setPlainThreshold(qint64 bytes)
 {
-  QRegularExpression reg(QStringLiteral("\"(.*?)\""));
-  QRegularExpressionMatchIterator matchIterator = reg.globalMatch(text);
-    while (matchIterator.hasNext())
-    {
-      QRegularExpressionMatch match = matchIterator.next();
-      setFormat(match.capturedStart(), match.capturedLength(), m_stringFormat);
-    }
+  m_plainThreshold = bytes;
+}
+
+JsonHighlighter::Mode JsonHighlighter::mode() const
+{
+  return m_mode;
+}
+
+JsonHighlighter::Mode JsonHighlighter::prepare(QTextDocument *document, qint64 size)
+{
+  m_idleTimer.stop();
+  m_pending = nullptr;
+  if (size > m_plainThreshold)
+  {
+    // Отсоединение снимает форматы со старого текста, новый не подсвечивается вовсе
+    m_mode = Plain;
+    setDocument(nullptr);
+    return m_mode;
+  }
+
+  m_mode = size > m_deferThreshold ? Deferred : Full;
+  m_idleNext = 0;
+  m_visibleFirst = 0;
+  m_visibleLast = kInitialBlocks;
+  if (m_mode == Deferred)
+  {
+    // Подключенный документ разбирал бы внутри setPlainText каждую строку
+    setDocument(nullptr);
+    m_pending = document;
+    return m_mode;
+  }
+  if (this->document() != document)
+  {
+    setDocument(document);
+  }
+  return m_mode;
+}
+
+void JsonHighlighter::attach()
+{
+  if (m_mode != Deferred || !m_pending)
+  {
+    return;
+  }
+  // После подключения QSyntaxHighlighter один раз проходит весь документ,
+  // но строки вне видимой области при этом не разбираются (см. highlightBlock)
+  setDocument(m_pending);
+  m_pending = nullptr;
+  setVisibleBlocks(m_visibleFirst, m_visibleLast);
+  // Таймер с нулевым интервалом срабатывает, когда очередь событий пуста
+  m_idleTimer.start();
 }
 
-void JsonHighlighter::highlightStringsKeys(const QString &text)
+void JsonHighlighter::setVisibleBlocks(int first, int last)
 {
-  QRegularExpression reg(QStringLiteral("\"[^\"]+\"\\s*:"));
-  QRegularExpressionMatchIterator matchIterator = reg.globalMatch(text);
-  while (matchIterator.hasNext())
+  m_visibleFirst = first;
+  m_visibleLast = last;
+  if (m_mode != Deferred || !document())
+  {
+    return;
+  }
+  QTextBlock block = document()->findBlockByNumber(qMax(first, m_idleNext));
+  for (; block.isValid() && block.blockNumber() <= last; block = block.next())
   {
-    QRegularExpressionMatch match = matchIterator.next();
-    setFormat(match.capturedStart(), match.capturedLength(), m_keyFormat);
+    rehighlightBlock(block);
   }
 }
 
-void JsonHighlighter::highlightNumbers(const QString &text)
+void JsonHighlighter::highlightSlice()
 {
-  QRegularExpression reg(QStringLiteral("[-+]?[0-9]*\\.?[0-9]+([eE][-+]?[0-9]+)?"));
-  QRegularExpressionMatchIterator matchIterator = reg.globalMatch(text);
-  while (matchIterator.hasNext())
+  if (m_mode != Deferred || !document())
   {
-    QRegularExpressionMatch match = matchIterator.next();
-    setFormat(match.capturedStart(), match.capturedLength(), m_numberFormat);
+    m_idleTimer.stop();
+    return;
   }
+  QElapsedTimer timer;
+  timer.start();
+  QTextBlock block = document()->findBlockByNumber(m_idleNext);
+  while (block.isValid() && timer.elapsed() < kSliceTime)
+  {
+    ++m_idleNext;
+    rehighlightBlock(block);
+    block = block.next();
+  }
+  if (!block.isValid())
+  {
+    m_mode = Full;
+    m_idleTimer.stop();
+  }
+}
+
+qint64 JsonHighlighter::takeElapsed()
+{
+  qint64 elapsed = m_elapsed;
+  m_elapsed = 0;
+  return elapsed;
+}
+
+bool JsonHighlighter::shouldFormat(int block) const
+{
+  return m_mode != Deferred || block < m_idleNext || (block >= m_visibleFirst && block <= m_visibleLast);
 }
 
-void JsonHighlighter::highlightBooleans(const QString &text)
+void JsonHighlighter::highlightBlock(const QString &text)
 {
-  QRegularExpression reg(QStringLiteral("(true|false)"));
-  QRegularExpressionMatchIterator matchIterator = reg.globalMatch(text);
-  while (matchIterator.hasNext())
+  QElapsedTimer timer;
+  timer.start();
+  // Строка, до которой еще не дошла фоновая подсветка, не разбирается: состояние
+  // переносится от предыдущей (корректный JSON не переносит строки внутри литерала)
+  int previous = previousBlockState();
+  if (!shouldFormat(currentBlock().blockNumber()))
   {
-    QRegularExpressionMatch match = matchIterator.next();
-    setFormat(match.capturedStart(), match.capturedLength(), m_booleanFormat);
+    setCurrentBlockState(previous);
+    m_elapsed += timer.nsecsElapsed();
+    return;
+  }
+  // Normal хранится как -1, исходное состояние блока: иначе смена состояния
+  // одной строки заставила бы QSyntaxHighlighter переразобрать все строки ниже
+  m_tokens.resize(0);
+  int state = JsonLexer::tokenize(text, qMax(previous, 0), m_tokens);
+  setCurrentBlockState(state == JsonLexer::Normal ? -1 : state);
+
+  for (const JsonToken &token : m_tokens)
+  {
+    switch (token.m_kind)
+    {
+    case JsonToken::Key:
+      setFormat(token.m_start, token.m_length, m_keyFormat);
+      break;
+    case JsonToken::String:
+      setFormat(token.m_start, token.m_length, m_stringFormat);
+      break;
+    case JsonToken::Number:
+      setFormat(token.m_start, token.m_length, m_numberFormat);
+      break;
+    case JsonToken::Literal:
+      setFormat(token.m_start, token.m_length, m_booleanFormat);
+      break;
+    }
   }
+  m_elapsed += timer.nsecsElapsed();
 }
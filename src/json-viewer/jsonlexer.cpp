@@ -0,0 +1,162 @@
+#include "jsonlexer.h"
+#include <cstring>
+
+namespace
+{
+  inline bool isDigit(ushort c)
+  {
+    return c >= '0' && c <= '9';
+  }
+
+  inline bool isNumberChar(ushort c)
+  {
+    return isDigit(c) || c == '.' || c == 'e' || c == 'E' || c == '+' || c == '-';
+  }
+
+  inline bool isLetter(ushort c)
+  {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+  }
+
+  inline bool isSpace(ushort c)
+  {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+  }
+
+  bool isLiteral(const ushort *word, int length)
+  {
+    static const char *const literals[] = { "true", "false", "null" };
+    for (const char *literal : literals)
+    {
+      int i = 0;
+      while (i < length && literal[i] == word[i])
+      {
+        ++i;
+      }
+      if (i == length && literal[i] == '\0')
+      {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  // Возвращает позицию за закрывающей кавычкой либо length, если строка
+  // не закрыта; state получает состояние на конце текста
+  int skipString(const ushort *data, int pos, int length, int &state)
+  {
+    bool escape = state == JsonLexer::InEscape;
+    for (; pos < length; ++pos)
+    {
+      if (escape)
+      {
+        escape = false;
+      }
+      else if (data[pos] == '\\')
+      {
+        escape = true;
+      }
+      else if (data[pos] == '"')
+      {
+        state = JsonLexer::Normal;
+        return pos + 1;
+      }
+    }
+    state = escape ? JsonLexer::InEscape : JsonLexer::InString;
+    return length;
+  }
+
+  JsonToken::Kind stringKind(const ushort *data, int pos, int length)
+  {
+    while (pos < length && isSpace(data[pos]))
+    {
+      ++pos;
+    }
+    return pos < length && data[pos] == ':' ? JsonToken::Key : JsonToken::String;
+  }
+}
+
+int JsonLexer::tokenize(const QString &text, int state, QVector<JsonToken> &tokens)
+{
+  const ushort *data = reinterpret_cast<const ushort *>(text.constData());
+  const int length = text.size();
+  int pos = 0;
+
+  // Продолжение строки, начатой в одной из предыдущих строк текста
+  if (state == InString || state == InEscape)
+  {
+    pos = skipString(data, 0, length, state);
+    tokens.append({ state == Normal ? stringKind(data, pos, length) : JsonToken::String, 0, pos });
+  }
+  else
+  {
+    state = Normal;
+  }
+
+  while (pos < length)
+  {
+    ushort c = data[pos];
+    int start = pos;
+    if (c == '"')
+    {
+      pos = skipString(data, pos + 1, length, state);
+      tokens.append({ state == Normal ? stringKind(data, pos, length) : JsonToken::String, start, pos - start });
+    }
+    else if (isDigit(c) || c == '-')
+    {
+      while (++pos < length && isNumberChar(data[pos]))
+      {
+      }
+      tokens.append({ JsonToken::Number, start, pos - start });
+    }
+    else if (isLetter(c))
+    {
+      while (++pos < length && isLetter(data[pos]))
+      {
+      }
+      if (isLiteral(data + start, pos - start))
+      {
+        tokens.append({ JsonToken::Literal, start, pos - start });
+      }
+    }
+    else
+    {
+      ++pos;
+    }
+  }
+  return state;
+}
+
+int JsonLexer::scan(const char *data, int length, int state)
+{
+  const char *end = data + length;
+  while (data < end)
+  {
+    if (state == Normal)
+    {
+      // Вне строки важна только открывающая кавычка
+      const char *quote = static_cast<const char *>(std::memchr(data, '"', size_t(end - data)));
+      if (!quote)
+      {
+        break;
+      }
+      data = quote + 1;
+      state = InString;
+      continue;
+    }
+    char c = *data++;
+    if (state == InEscape)
+    {
+      state = InString;
+    }
+    else if (c == '\\')
+    {
+      state = InEscape;
+    }
+    else if (c == '"')
+    {
+      state = Normal;
+    }
+  }
+  return state;
+}
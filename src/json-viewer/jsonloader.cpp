@@ -0,0 +1,337 @@
+#include "jsonloader.h"
+
+#include <cstring>
+#include <limits>
+
+// Размер порции JSON Lines: первые записи появляются в модели через считанные миллисекунды.
+static const int kLinesBatchBytes = 1 << 20;
+
+// Размер окна, которым читается JSON Lines больше 2 ГБ.
+static const int kLinesWindowBytes = 64 << 20;
+
+JsonLoader::JsonLoader(QObject *parent) : QThread(parent), m_windowBytes(kLinesWindowBytes)
+{
+}
+
+JsonLoader::~JsonLoader()
+{
+  cancel();
+  wait();
+}
+
+void JsonLoader::load(const MappedFile &file)
+{
+  start(file, QByteArray(), true, false);
+}
+
+void JsonLoader::load(const QByteArray &json)
+{
+  start(MappedFile(), json, false, false);
+}
+
+void JsonLoader::loadLines(const MappedFile &file)
+{
+  start(file, QByteArray(), true, true);
+}
+
+void JsonLoader::loadLines(const QByteArray &json)
+{
+  start(MappedFile(), json, false, true);
+}
+
+void JsonLoader::start(const MappedFile &file, const QByteArray &json, bool fromFile, bool lines)
+{
+  cancel();
+  wait();
+
+  QMutexLocker locker(&m_mutex);
+  m_file = file;
+  m_json = json;
+  m_fromFile = fromFile;
+  m_lines = lines;
+  m_tree = JsonTree();
+  m_batches.clear();
+  m_index.clear();
+  m_indexReady = false;
+  m_profile.clear();
+  m_error = JsonParseError();
+  m_ok = false;
+  m_canceled = false;
+  m_cancel.storeRelease(0);
+  locker.unlock();
+
+  QThread::start();
+}
+
+void JsonLoader::cancel()
+{
+  m_cancel.storeRelease(1);
+}
+
+void JsonLoader::setLazy(bool lazy)
+{
+  QMutexLocker locker(&m_mutex);
+  m_lazy = lazy;
+}
+
+void JsonLoader::setWindowBytes(int bytes)
+{
+  QMutexLocker locker(&m_mutex);
+  m_windowBytes = bytes;
+}
+
+bool JsonLoader::takeTree(JsonTree &tree)
+{
+  QMutexLocker locker(&m_mutex);
+  if (!m_ok)
+  {
+    return false;
+  }
+  tree = std::move(m_tree);
+  m_tree = JsonTree();
+  m_ok = false;
+  return true;
+}
+
+QVector<JsonTree> JsonLoader::takeBatches()
+{
+  QMutexLocker locker(&m_mutex);
+  QVector<JsonTree> batches;
+  batches.swap(m_batches);
+  return batches;
+}
+
+bool JsonLoader::takeIndex(JsonSearchIndex &index)
+{
+  QMutexLocker locker(&m_mutex);
+  if (!m_indexReady)
+  {
+    return false;
+  }
+  index = std::move(m_index);
+  m_index = JsonSearchIndex();
+  m_indexReady = false;
+  return true;
+}
+
+JsonParseError JsonLoader::error() const
+{
+  QMutexLocker locker(&m_mutex);
+  return m_error;
+}
+
+LoadProfile JsonLoader::profile() const
+{
+  QMutexLocker locker(&m_mutex);
+  return m_profile;
+}
+
+bool JsonLoader::wasCanceled() const
+{
+  QMutexLocker locker(&m_mutex);
+  return m_canceled;
+}
+
+void JsonLoader::run()
+{
+  QMutexLocker locker(&m_mutex);
+  MappedFile file = m_file;
+  QByteArray json = m_json;
+  bool fromFile = m_fromFile;
+  bool lines = m_lines;
+  bool lazy = m_lazy;
+  m_file = MappedFile();
+  m_json = QByteArray();
+  locker.unlock();
+
+  JsonParser parser;
+  parser.setLazy(lazy);
+  parser.setCancelFlag(&m_cancel);
+  parser.setProgressHandler([this](qint64 done, qint64 total)
+  {
+    emit progressChanged(done, total);
+  });
+
+  JsonSearchIndex index;
+  LoadProfile profile;
+  if (lines)
+  {
+    QByteArray source = fromFile ? file.bytes() : json;
+    JsonParseError error;
+    {
+      LoadProfile::Scope scope(profile, "parse");
+      runLines(parser, file, source, error);
+    }
+    bool indexed = !parser.wasCanceled() && !file.isWindowed();
+    if (indexed)
+    {
+      LoadProfile::Scope scope(profile, "index");
+      index.build(source);
+    }
+    locker.relock();
+    profile.setStatus(parser.wasCanceled() ? LoadProfile::Canceled : error.m_offset >= 0 ? LoadProfile::Error : LoadProfile::Ok);
+    m_index = std::move(index);
+    m_profile = profile;
+    m_indexReady = indexed;
+    m_error = error;
+    m_canceled = parser.wasCanceled();
+    return;
+  }
+
+  JsonTree tree;
+  bool ok = false;
+  {
+    LoadProfile::Scope scope(profile, "parse");
+    ok = fromFile ? parser.parse(file, tree) : parser.parse(json, tree);
+  }
+
+  // Дерево отдается сразу после разбора, индекс строится уже после этого;
+  // отображение файла на это время удерживает file
+  QByteArray source = tree.m_source;
+  locker.relock();
+  m_tree = std::move(tree);
+  m_error = parser.error();
+  m_ok = ok;
+  locker.unlock();
+  if (ok)
+  {
+    emit treeReady();
+    LoadProfile::Scope scope(profile, "index");
+    index.build(source);
+  }
+
+  profile.setStatus(parser.wasCanceled() ? LoadProfile::Canceled : ok ? LoadProfile::Ok : LoadProfile::Error);
+  locker.relock();
+  m_index = std::move(index);
+  m_profile = profile;
+  m_indexReady = ok;
+  m_canceled = parser.wasCanceled();
+}
+
+void JsonLoader::runLines(JsonParser &parser, const MappedFile &file, const QByteArray &source, JsonParseError &error)
+{
+  JsonTree root;
+  JsonParser::startLines(source, root);
+  root.m_file = file;
+  {
+    QMutexLocker locker(&m_mutex);
+    m_tree = std::move(root);
+    m_ok = true;
+  }
+  emit recordsReady();
+
+  if (file.isWindowed())
+  {
+    runWindows(parser, file, error);
+  }
+  else
+  {
+    parseBatches(parser, source, nullptr, source.size());
+    error = parser.error();
+  }
+}
+
+bool JsonLoader::runWindows(JsonParser &parser, const MappedFile &file, JsonParseError &error)
+{
+  // Окна отображаются подряд по 64-битным позициям файла, смещения внутри окна - int.
+  // Окно обрезается по последнему переводу строки, неполная строка начинает следующее окно;
+  // строка длиннее окна удваивает его
+  QMutexLocker locker(&m_mutex);
+  const int windowBytes = m_windowBytes;
+  locker.unlock();
+
+  QVector<QByteArray> parsed;
+  qint64 filePos = 0;
+  while (filePos < file.size())
+  {
+    qint64 rest = file.size() - filePos;
+    int size = int(qMin<qint64>(windowBytes, rest));
+    TextWindow window;
+    window.m_filePos = filePos;
+    while (true)
+    {
+      window.m_bytes = file.window(filePos, size);
+      if (window.m_bytes.isEmpty() || size == rest)
+      {
+        break;
+      }
+      int end = window.m_bytes.lastIndexOf('\n') + 1;
+      if (end > 0)
+      {
+        window.m_bytes = QByteArray::fromRawData(window.m_bytes.constData(), end);
+        break;
+      }
+      if (size == std::numeric_limits<int>::max())
+      {
+        window.m_bytes.clear();
+        break;
+      }
+      size = int(qMin<qint64>(qMin<qint64>(qint64(size) * 2, rest), std::numeric_limits<int>::max()));
+    }
+
+    // Прогресс парсера считается от начала окна
+    qint64 total = file.size();
+    parser.setProgressHandler([this, filePos, total](qint64 done, qint64)
+    {
+      emit progressChanged(filePos + done, total);
+    });
+    bool ok = !window.m_bytes.isEmpty() && parseBatches(parser, window.m_bytes, &window, total);
+    if (!ok)
+    {
+      error = parser.error();
+      if (window.m_bytes.isEmpty())
+      {
+        error.m_message = QStringLiteral("Не удалось прочитать строку файла с позиции %1").arg(filePos);
+        error.m_offset = 0;
+        error.m_line = 1;
+        error.m_column = 1;
+      }
+      if (!parser.wasCanceled())
+      {
+        // Строка ошибки в окне переводится в строку файла, смещение остается от начала окна.
+        // Переводы строк в прочитанных окнах считаются только при ошибке
+        for (const QByteArray &bytes : parsed)
+        {
+          const char *data = bytes.constData();
+          const char *end = data + bytes.size();
+          while ((data = static_cast<const char *>(std::memchr(data, '\n', size_t(end - data)))))
+          {
+            error.m_line++;
+            data++;
+          }
+        }
+      }
+      return false;
+    }
+    parsed.append(window.m_bytes);
+    filePos += window.m_bytes.size();
+  }
+  return true;
+}
+
+bool JsonLoader::parseBatches(JsonParser &parser, const QByteArray &source, const TextWindow *window, qint64 total)
+{
+  qint64 base = window ? window->m_filePos : 0;
+  int pos = 0;
+  while (pos < source.size())
+  {
+    JsonTree batch;
+    bool ok = parser.parseLines(source, pos, kLinesBatchBytes, batch);
+    if (!batch.isEmpty() && batch.m_nodes.at(0).m_childCount > 0)
+    {
+      if (window)
+      {
+        batch.m_windows.append(*window);
+      }
+      QMutexLocker locker(&m_mutex);
+      m_batches.append(batch);
+    }
+    emit recordsReady();
+    if (!ok)
+    {
+      return false;
+    }
+    emit progressChanged(base + pos, total);
+  }
+  return true;
+}
@@ -1,332 +1,504 @@
 #include "jsonmodel.h"
+#include "jsonparser.h"
+#include <cstring>
 
-JsonModel::JsonModel(QObject *parent) : QAbstractItemModel(parent)
+namespace
 {
-  m_root = nullptr;
-}
+  const int kCompareBlock = 4096;
 
-JsonModel::~JsonModel()
-{
-  delete m_root;
-}
+  // Сколько узлов и ссылок на детей, брошенных частичными обновлениями, допускается
+  // без полного разбора, даже если это больше четверти дерева
+  const int kMinGarbage = 4096;
 
-void JsonModel::addItem(const QString &text, const QModelIndex &parent)
-{
-  auto node = new Node{text};
-  if (parent.isValid())
+  // Длина общего начала двух буферов: сначала сравниваются целые блоки
+  int commonPrefix(const char *a, const char *b, int size)
   {
-    auto parentNode = getNode(parent);
-    parentNode->m_children.append(node);
-    node->m_parent = parentNode;
+    int pos = 0;
+    while (pos + kCompareBlock <= size && std::memcmp(a + pos, b + pos, kCompareBlock) == 0)
+    {
+      pos += kCompareBlock;
+    }
+    while (pos < size && a[pos] == b[pos])
+    {
+      pos++;
+    }
+    return pos;
   }
-  else
+
+  int commonSuffix(const char *aEnd, const char *bEnd, int size)
   {
-    m_root = node;
-    m_root->m_parent = nullptr;
+    int count = 0;
+    while (count + kCompareBlock <= size
+           && std::memcmp(aEnd - count - kCompareBlock, bEnd - count - kCompareBlock, kCompareBlock) == 0)
+    {
+      count += kCompareBlock;
+    }
+    while (count < size && aEnd[-count - 1] == bEnd[-count - 1])
+    {
+      count++;
+    }
+    return count;
   }
 
-  beginInsertRows(parent, rowCount(parent), rowCount(parent));
-  endInsertRows();
-
-  if (parent.isValid())
+  bool isTokenChar(char c)
   {
-    emit dataChanged(parent, parent);
+    return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z')
+           || c == '.' || c == '+' || c == '-';
   }
-  else
+
+  // Первая строка из [low, high), для которой pred ложно; pred монотонен по строкам
+  template <typename Pred>
+  int partitionPoint(int low, int high, Pred pred)
   {
-    emit dataChanged(index(0, 0), index(rowCount(), 0));
+    while (low < high)
+    {
+      int mid = low + (high - low) / 2;
+      if (pred(mid))
+      {
+        low = mid + 1;
+      }
+      else
+      {
+        high = mid;
+      }
+    }
+    return low;
   }
 }
 
-bool JsonModel::loadJson(const QByteArray &jsonBytes)
+JsonModel::JsonModel(QObject *parent) : QAbstractItemModel(parent)
 {
-  clear();
-  QString json = QString::fromUtf8(jsonBytes);
-  int pos = 0;
-  pos = skipWhitespace(json, pos);
-    
-  if (pos >= json.length())
-  {
-    return false;
-  }
-
-  beginResetModel();
-  parseValue(json, pos, QModelIndex());
-  endResetModel();
-    
-  return true;
 }
 
+JsonModel::~JsonModel()
+{
+}
 
-bool JsonModel::hasElement(const QModelIndex &parent, const QString &text) const
+bool JsonModel::loadJson(const QByteArray &jsonBytes)
 {
-  int rows = rowCount(parent);
-  for (int i = 0; i < rows; ++i)
-  {
-    QModelIndex idx = index(i, 0, parent);
-    QString dataText = data(idx, Qt::DisplayRole).toString();
-    if (dataText == text) return true;
-  }
-  return false;
+  JsonTree tree;
+  bool ok = JsonParser().parse(jsonBytes, tree);
+  setTree(std::move(tree));
+  return ok;
 }
 
+bool JsonModel::loadFile(const MappedFile &file)
+{
+  JsonTree tree;
+  bool ok = JsonParser().parse(file, tree);
+  setTree(std::move(tree));
+  return ok;
+}
 
-int JsonModel::skipWhitespace(const QString &json, int pos)
+void JsonModel::setTree(JsonTree tree)
 {
-  while (pos < json.length() && (json[pos].isSpace() || json[pos] == '\n' || json[pos] == '\r' || json[pos] == '\t'))
+  beginResetModel();
+  m_tree = std::move(tree);
+  m_keyText.clear();
+  m_expandableCount = 0;
+  m_expandedCount = 0;
+  m_deadNodes = 0;
+  m_deadChildIds = 0;
+  if (!m_tree.isEmpty())
   {
-    pos++;
+    trackSubtree(0, true);
   }
-  return pos;
+  endResetModel();
 }
 
-QString JsonModel::parseString(const QString &json, int &pos)
+void JsonModel::appendRecords(const JsonTree &batch)
 {
-  QString res;
-  if (json[pos] != '"')
+  int count = batch.isEmpty() ? 0 : batch.m_nodes.at(0).m_childCount;
+  if (!m_tree.m_lines || count == 0)
   {
-    return res;
+    return;
   }
-  pos++;
-    
-  while (pos < json.length())
+  int first = m_tree.m_records.size();
+  beginInsertRows(rootIndex(), first, first + count - 1);
+  // Первая порция из нового окна файла регистрирует окно: смещения ее узлов отсчитываются от него
+  if (!batch.m_windows.isEmpty()
+      && (m_tree.m_windows.isEmpty() || m_tree.m_windows.last().m_filePos != batch.m_windows.at(0).m_filePos))
   {
-    QChar c = json[pos];
-    if (c == '"')
-    {
-      pos++;
-      return res;
-    }
-    if (c == '\\')
-    {
-      pos++;
-      if (pos >= json.length())
-      {
-        break;
-      }
-      res.append(json[pos]); 
-    }
-    else
-    {
-      res.append(c);
-    }
-    pos++;
+    TextWindow window = batch.m_windows.at(0);
+    window.m_firstRecord = first;
+    m_tree.m_windows.append(window);
   }
-  return res;
-}
-
-QString JsonModel::parseNumber(const QString &json, int &pos)
-{
-  int start = pos;
-  while (pos < json.length() && (json[pos].isDigit() || json[pos] == '.' || json[pos] == '-' || json[pos] == 'e' || json[pos] == 'E' || json[pos] == '+'))
+  JsonParser::appendPart(m_tree, batch, 0, m_tree.m_records);
+  m_tree.m_nodes[0].m_childCount = m_tree.m_records.size();
+  if (first == 0)
   {
-    pos++;
+    m_expandableCount++;
   }
-  return json.mid(start, pos - start);
+  for (int row = first; row < m_tree.m_records.size(); ++row)
+  {
+    trackSubtree(m_tree.m_records.at(row), true);
+  }
+  endInsertRows();
 }
 
-QString JsonModel::parseBoolNull(const QString &json, int &pos)
+bool JsonModel::updateSource(const QByteArray &json, TextSpan *replaced)
 {
-  if (json.midRef(pos).startsWith("true"))
-  { 
-    pos += 4; 
-    return "true";
-  }
-  if (json.midRef(pos).startsWith("false"))
+  // Частичное обновление: изменившийся участок текста находится сравнением начала и конца,
+  // по смещениям узлов ищется наименьший контейнер, скобки которого не затронуты,
+  // и заново разбираются только его элементы, задетые правкой. Остальные узлы сохраняют id,
+  // поэтому раскрытые ветки и выделение в представлении не сбрасываются.
+  // false - правку нельзя применить частично (или текст невалиден), нужен полный разбор.
+  // Замененные узлы остаются в массивах дерева; когда их больше четверти,
+  // документ тоже разбирается заново, и полный разбор их отбрасывает
+  if (m_tree.isEmpty() || !m_tree.m_windows.isEmpty()
+      || m_deadNodes > qMax(kMinGarbage, m_tree.m_nodes.size() / 4)
+      || m_deadChildIds > qMax(kMinGarbage, m_tree.m_childIds.size() / 4))
   {
-    pos += 5;
-    return "false";
+    return false;
   }
-  if (json.midRef(pos).startsWith("null"))
+  const QByteArray &old = m_tree.m_source;
+  int oldSize = old.size();
+  int limit = qMin(oldSize, json.size());
+  int begin = commonPrefix(old.constData(), json.constData(), limit);
+  if (begin == oldSize && begin == json.size())
   {
-    pos += 4;
-    return "null";
+    return true;
   }
-    return QString();
-}
+  int end = oldSize - commonSuffix(old.constData() + oldSize, json.constData() + json.size(), limit - begin);
+  int delta = json.size() - oldSize;
 
-int JsonModel::parseValue(const QString &json, int pos, const QModelIndex &parent, const QString &key)
-{
-  pos = skipWhitespace(json, pos);
-  if (pos >= json.length())
+  int containerId = enclosingContainer(begin, end);
+  if (containerId < 0 || (containerId == 0 && m_tree.m_lines))
   {
-    return pos;
+    return false;
   }
-
-  QChar c = json[pos];
-
-  if (c == '{')
+  const Node container = m_tree.m_nodes.at(containerId);
+
+  // Элементы [first, last) задеты правкой, остальные остаются как есть.
+  // Число или литерал вплотную к правке не изменились, только если новый соседний символ
+  // не продолжает токен. Строки и скобки замкнуты кавычками
+  int count = container.m_childCount;
+  auto closedValue = [this](int id)
+  {
+    NodeType type = m_tree.m_nodes.at(id).m_type;
+    return type == NodeType::String || type == NodeType::Object || type == NodeType::Array;
+  };
+  bool cutAfter = begin < json.size() && !isTokenChar(json.at(begin));
+  bool cutBefore = end + delta > 0 && !isTokenChar(json.at(end + delta - 1));
+  int first = partitionPoint(0, count, [this, containerId, begin, cutAfter, &closedValue](int row)
+  {
+    int id = m_tree.childId(containerId, row);
+    int extent = extentEnd(id);
+    return extent < begin || (extent == begin && (cutAfter || closedValue(id)));
+  });
+  int last = partitionPoint(first, count, [this, containerId, end, cutBefore, &closedValue](int row)
+  {
+    int id = m_tree.childId(containerId, row);
+    int extent = extentStart(id);
+    bool closedStart = m_tree.m_nodes.at(id).hasKey() || closedValue(id);
+    return extent < end || (extent == end && !cutBefore && !closedStart);
+  });
+
+  int rangeBegin = first > 0 ? extentEnd(m_tree.childId(containerId, first - 1))
+                             : container.m_value.m_offset + 1;
+  int rangeEnd = last < count ? extentStart(m_tree.childId(containerId, last))
+                              : container.m_value.m_offset + container.m_value.m_length - 1;
+  JsonTree part;
+  if (!JsonParser().parseRange(json, rangeBegin, rangeEnd + delta, container.m_type,
+                               first > 0, last < count, part))
   {
-    return parseObject(json, pos, parent, key);
+    return false;
   }
-  else if (c == '[')
+  if (replaced)
   {
-    return parseArray(json, pos, parent, key);
+    replaced->m_offset = rangeBegin;
+    replaced->m_length = rangeEnd - rangeBegin;
   }
-  else
+
+  // Отображение файла больше не нужно: представления текста к этому времени
+  // должны перейти на новый текст
+  m_tree.m_source = json;
+  m_tree.m_file = MappedFile();
+  shiftSpans(containerId, last, delta);
+
+  const Node &holder = part.m_nodes.at(0);
+  int oldCount = last - first;
+  int newCount = holder.m_childCount;
+  QModelIndex parentIndex = indexOf(containerId);
+
+  // Правка значений без изменения структуры: узлы обновляются на месте
+  bool sameShape = oldCount == newCount;
+  for (int i = 0; sameShape && i < newCount; ++i)
+  {
+    const Node &oldNode = m_tree.m_nodes.at(m_tree.childId(containerId, first + i));
+    const Node &newNode = part.m_nodes.at(part.m_childIds.at(holder.m_firstChild + i));
+    sameShape = oldNode.m_childCount == 0 && newNode.m_childCount == 0
+                && oldNode.m_type != NodeType::Object && oldNode.m_type != NodeType::Array
+                && newNode.m_type != NodeType::Object && newNode.m_type != NodeType::Array;
+  }
+  if (sameShape)
   {
-    QString valStr;
-    if (c == '"') 
+    QVector<int> keyIds = m_tree.m_keys.merge(part.m_keys);
+    for (int i = 0; i < newCount; ++i)
     {
-      valStr = "\"" + parseString(json, pos) + "\"";
+      Node &oldNode = m_tree.m_nodes[m_tree.childId(containerId, first + i)];
+      const Node &newNode = part.m_nodes.at(part.m_childIds.at(holder.m_firstChild + i));
+      oldNode.m_keyId = newNode.m_keyId >= 0 ? keyIds.at(newNode.m_keyId) : newNode.m_keyId;
+      oldNode.m_value = newNode.m_value;
+      oldNode.m_type = newNode.m_type;
     }
-    else if (c.isDigit() || c == '-')
+    if (newCount > 0)
     {
-        valStr = parseNumber(json, pos);
+      emit dataChanged(index(first, 0, parentIndex), index(last - 1, 0, parentIndex));
     }
-    else
+    return true;
+  }
+
+  // Структура изменилась: задетые строки удаляются и вставляются заново.
+  // Старые узлы остаются в массиве неиспользуемыми до следующей полной загрузки,
+  // их число учитывает trackSubtree()
+  QVector<int> ids;
+  ids.reserve(count - oldCount + newCount);
+  for (int row = 0; row < count; ++row)
+  {
+    ids.append(m_tree.childId(containerId, row));
+  }
+  bool wasExpandable = count > 0;
+  if (oldCount > 0)
+  {
+    beginRemoveRows(parentIndex, first, last - 1);
+    for (int row = first; row < last; ++row)
     {
-      valStr = parseBoolNull(json, pos);
+      trackSubtree(ids.at(row), false);
     }
-
-    QString displayText;
-    if (!key.isEmpty())
+    ids.remove(first, oldCount);
+    setChildren(containerId, ids);
+    endRemoveRows();
+  }
+  if (newCount > 0)
+  {
+    beginInsertRows(parentIndex, first, first + newCount - 1);
+    QVector<int> inserted;
+    JsonParser::appendPart(m_tree, part, containerId, inserted);
+    for (int i = 0; i < inserted.size(); ++i)
     {
-      displayText = key + " : " + valStr;
+      ids.insert(first + i, inserted.at(i));
+      trackSubtree(inserted.at(i), true);
     }
-    else 
+    setChildren(containerId, ids);
+    endInsertRows();
+  }
+  if (wasExpandable != !ids.isEmpty())
+  {
+    Node &node = m_tree.m_nodes[containerId];
+    m_expandableCount += ids.isEmpty() ? -1 : 1;
+    if (isExpanded(node))
     {
-      displayText = valStr;
+      node.m_expandEpoch = 0;
+      m_expandedCount--;
     }
-
-    addItem(displayText, parent);
   }
-  return pos;
+  if (oldCount != newCount)
+  {
+    emit dataChanged(parentIndex, parentIndex);
+  }
+  return true;
 }
 
-int JsonModel::parseObject(const QString &json, int pos, const QModelIndex &parent, const QString &key)
+void JsonModel::fetchAll()
 {
-  QString header = key.isEmpty() ? "object" : key;
-  addItem(header, parent); 
-    
-  QModelIndex objIndex = index(rowCount(parent) - 1, 0, parent);
-  Node* objNode = getNode(objIndex);
-
-  pos++;
-  int count = 0;
+  // Для "Развернуть все": отложенные контейнеры строятся разом под одним сбросом модели,
+  // а не вставкой строк на каждый раскрытый узел
+  bool deferred = false;
+  visitSubtree(0, [this, &deferred](int id)
+  {
+    const Node &node = m_tree.m_nodes.at(id);
+    deferred = deferred || (!node.childrenLoaded() && node.m_childCount > 0);
+  });
+  if (!deferred)
+  {
+    return;
+  }
+  beginResetModel();
+  JsonParser parser;
+  visitSubtree(0, [this, &parser](int id)
+  {
+    parser.materialize(m_tree, id);
+  });
+  m_expandableCount = 0;
+  m_expandedCount = 0;
+  trackSubtree(0, true);
+  endResetModel();
+}
 
-  while (pos < json.length())
+QModelIndex JsonModel::locate(int offset)
+{
+  // Самый глубокий узел, текст которого (с ключом) содержит offset. По пути
+  // достраиваются отложенные контейнеры, остальные ветки не трогаются
+  if (m_tree.isEmpty())
   {
-    pos = skipWhitespace(json, pos);
-    if (json[pos] == '}')
-    {
-      pos++;
-      break;
-    }
-        
-    if (count > 0)
+    return QModelIndex();
+  }
+  int id = 0;
+  while (true)
+  {
+    QModelIndex index = indexOf(id);
+    fetchMore(index);
+    const Node &node = m_tree.m_nodes.at(id);
+    int row = partitionPoint(0, node.m_childCount, [this, id, offset](int row)
     {
-      if (json[pos] == ',')
-      {
-        pos++;
-      }
-      pos = skipWhitespace(json, pos);
-    }
-
-    QString itemKey = parseString(json, pos);
-    pos = skipWhitespace(json, pos);
-    if (json[pos] == ':')
+      return extentStart(m_tree.childId(id, row)) <= offset;
+    }) - 1;
+    if (row < 0 || extentEnd(m_tree.childId(id, row)) <= offset)
     {
-      pos++;
+      return index;
     }
-        
-    pos = parseValue(json, pos, objIndex, itemKey);
-    count++;
+    id = m_tree.childId(id, row);
   }
+}
 
-  QString finalHeader;
-  if (key.isEmpty())
+QModelIndexList JsonModel::query(const JsonQuery &query)
+{
+  // Отложенные контейнеры на пути запроса достраиваются обычным fetchMore(),
+  // а перед обходом потомков дерево достраивается целиком одним сбросом
+  if (query.hasDescendants())
   {
-    finalHeader = "object {" + QString::number(count) + "}";
+    fetchAll();
   }
-  else
+  QModelIndexList result;
+  const QVector<int> ids = query.evaluate(m_tree, [this](int id)
+  {
+    fetchMore(indexOf(id));
+  });
+  for (int id : ids)
   {
-    finalHeader = key + " {" + QString::number(count) + "}";
+    result.append(indexOf(id));
   }
-    
-  objNode->m_text = finalHeader;
-   
-  return pos;
+  return result;
 }
 
-int JsonModel::parseArray(const QString &json, int pos, const QModelIndex &parent, const QString &key)
+void JsonModel::setExpanded(const QModelIndex &index, bool expanded)
 {
-  QString header;
-  if (key.isEmpty())
+  if (!index.isValid())
   {
-    header = "array";
+    return;
   }
-  else
+  Node &node = m_tree.m_nodes[nodeId(index)];
+  if (isExpanded(node) == expanded || node.m_childCount == 0)
   {
-    header = key;
+    return;
   }
-    
-  addItem(header, parent);
-  QModelIndex arrIndex = index(rowCount(parent) - 1, 0, parent);
-  Node* arrNode = getNode(arrIndex);
-
-  pos++;
-  int count = 0;
+  node.m_expandEpoch = expanded ? m_expandEpoch : 0;
+  m_expandedCount += expanded ? 1 : -1;
+}
 
-  while (pos < json.length())
+void JsonModel::setAllExpanded(bool expanded)
+{
+  if (!expanded)
   {
-    pos = skipWhitespace(json, pos);
-    if (json[pos] == ']')
-    {
-      pos++;
-      break;
-    }
-
-    if (count > 0)
+    // Новая эпоха сворачивает все узлы сразу; только при переполнении
+    // счетчика старые отметки стираются проходом по массиву
+    if (++m_expandEpoch == 0)
     {
-      if (json[pos] == ',')
+      for (Node &node : m_tree.m_nodes)
       {
-        pos++;
+        node.m_expandEpoch = 0;
       }
-      pos = skipWhitespace(json, pos);
+      m_expandEpoch = 1;
     }
-
-    QString indexKey = QString::number(count);
-    pos = parseValue(json, pos, arrIndex, indexKey);
-    count++;
+    m_expandedCount = 0;
+    return;
   }
-
-  QString finalHeader;
-  if (key.isEmpty())
+  if (m_tree.isEmpty())
   {
-    finalHeader = "array [" + QString::number(count) + "]";
+    return;
   }
-  else
+  visitSubtree(0, [this](int id)
+  {
+    Node &node = m_tree.m_nodes[id];
+    node.m_expandEpoch = node.m_childCount > 0 ? m_expandEpoch : 0;
+  });
+  m_expandedCount = m_expandableCount;
+}
+
+bool JsonModel::allExpanded() const
+{
+  return m_expandableCount > 0 && m_expandedCount == m_expandableCount;
+}
+
+bool JsonModel::isExpanded(const Node &node) const
+{
+  return node.m_expandEpoch == m_expandEpoch;
+}
+
+int JsonModel::expandableCount() const
+{
+  return m_expandableCount;
+}
+
+int JsonModel::expandedCount() const
+{
+  return m_expandedCount;
+}
+
+const QByteArray &JsonModel::source() const
+{
+  return m_tree.m_source;
+}
+
+const MappedFile &JsonModel::file() const
+{
+  return m_tree.m_file;
+}
+
+qint64 JsonModel::sourceSize() const
+{
+  qint64 size = m_tree.m_source.size();
+  for (const TextWindow &window : m_tree.m_windows)
   {
-    finalHeader = key + " [" + QString::number(count) + "]";
+    size += window.m_bytes.size();
   }
+  return size;
+}
 
-  arrNode->m_text = finalHeader;
-    
-  return pos;
+int JsonModel::nodeCount() const
+{
+  return m_tree.m_nodes.size();
+}
+
+qint64 JsonModel::memoryUsage() const
+{
+  return m_tree.memoryUsage();
+}
+
+bool JsonModel::hasElement(const QModelIndex &parent, const QString &text) const
+{
+  int rows = rowCount(parent);
+  for (int i = 0; i < rows; ++i)
+  {
+    QModelIndex idx = index(i, 0, parent);
+    QString dataText = data(idx, Qt::DisplayRole).toString();
+    if (dataText == text) return true;
+  }
+  return false;
 }
 
 QModelIndex JsonModel::index(int row, int column, const QModelIndex &parent) const
 {
-  if (column != 0)
+  if (column != 0 || row < 0)
   {
     return QModelIndex();
   }
 
   if (!parent.isValid())
   {
-    if (row == 0 && m_root != nullptr) return createIndex(row, 0, m_root);
+    if (row == 0 && !m_tree.m_nodes.isEmpty())
     {
-        return QModelIndex();
+      return createIndex(row, 0, quintptr(0));
     }
+    return QModelIndex();
   }
-  else
+
+  int parentId = nodeId(parent);
+  const Node &parentNode = m_tree.m_nodes.at(parentId);
+  if (parentNode.childrenLoaded() && row < parentNode.m_childCount)
   {
-    auto parentNode = getNode(parent);
-    if (row >= 0 && row < parentNode->m_children.size())
-    {
-        return createIndex(row, 0, parentNode->m_children.at(row));
-    }
+    return createIndex(row, 0, quintptr(m_tree.childId(parentId, row)));
   }
   return QModelIndex();
 }
@@ -337,30 +509,23 @@ QModelIndex JsonModel::parent(const QModelIndex &child) const
   {
     return QModelIndex();
   }
-  auto node = getNode(child);
-  if (!node || !node->m_parent)
+
+  int parentId = m_tree.m_nodes.at(nodeId(child)).m_parent;
+  if (parentId < 0)
   {
     return QModelIndex();
   }
-    
-  Node* parentNode = node->m_parent;
-  if (!parentNode->m_parent)
-  {
-    return createIndex(0, 0, parentNode);
-  }
-
-  int row = parentNode->m_parent->m_children.indexOf(parentNode);
-  return createIndex(row, 0, parentNode);
+  return createIndex(m_tree.m_nodes.at(parentId).m_row, 0, quintptr(parentId));
 }
 
 int JsonModel::rowCount(const QModelIndex &parent) const
 {
   if (!parent.isValid())
   {
-    return m_root ? 1 : 0;
+    return m_tree.m_nodes.isEmpty() ? 0 : 1;
   }
-  auto parentNode = getNode(parent);
-  return parentNode ? parentNode->m_children.size() : 0;
+  const Node &node = m_tree.m_nodes.at(nodeId(parent));
+  return node.childrenLoaded() ? node.m_childCount : 0;
 }
 
 int JsonModel::columnCount(const QModelIndex &) const
@@ -368,20 +533,116 @@ int JsonModel::columnCount(const QModelIndex &) const
   return 1;
 }
 
+bool JsonModel::hasChildren(const QModelIndex &parent) const
+{
+  if (!parent.isValid())
+  {
+    return !m_tree.m_nodes.isEmpty();
+  }
+  return m_tree.m_nodes.at(nodeId(parent)).m_childCount > 0;
+}
+
+bool JsonModel::canFetchMore(const QModelIndex &parent) const
+{
+  if (!parent.isValid())
+  {
+    return false;
+  }
+  const Node &node = m_tree.m_nodes.at(nodeId(parent));
+  return !node.childrenLoaded() && node.m_childCount > 0;
+}
+
+void JsonModel::fetchMore(const QModelIndex &parent)
+{
+  if (!canFetchMore(parent))
+  {
+    return;
+  }
+  int id = nodeId(parent);
+  beginInsertRows(parent, 0, m_tree.m_nodes.at(id).m_childCount - 1);
+  JsonParser().materialize(m_tree, id);
+  for (int row = 0; row < m_tree.m_nodes.at(id).m_childCount; ++row)
+  {
+    trackSubtree(m_tree.childId(id, row), true);
+  }
+  endInsertRows();
+}
+
 QVariant JsonModel::data(const QModelIndex &index, int role) const
 {
   if (!index.isValid())
   {
     return QVariant();
   }
-  auto node = getNode(index);
   if (role == Qt::DisplayRole)
   {
-    return node->m_text;
+    return displayText(index);
   }
   return QVariant();
 }
 
+QString JsonModel::displayText(const QModelIndex &index) const
+{
+  const Node &node = m_tree.m_nodes.at(nodeId(index));
+  bool hasKey = node.m_parent >= 0;
+  QString key;
+  if (hasKey)
+  {
+    if (m_tree.m_nodes.at(node.m_parent).m_type == NodeType::Array)
+    {
+      key = QString::number(index.row());
+    }
+    else
+    {
+      key = keyText(nodeId(index));
+    }
+  }
+
+  switch (node.m_type)
+  {
+  case NodeType::Object:
+    return (hasKey ? key : QStringLiteral("object")) + " {" + QString::number(node.m_childCount) + "}";
+  case NodeType::Array:
+    return (hasKey ? key : QStringLiteral("array")) + " [" + QString::number(node.m_childCount) + "]";
+  default:
+    break;
+  }
+
+  QString value;
+  const char *text = m_tree.sourceOf(nodeId(index)).constData() + node.m_value.m_offset;
+  if (node.m_type == NodeType::String)
+  {
+    value = "\"" + JsonParser::decodeString(text, node.m_value.m_length) + "\"";
+  }
+  else
+  {
+    value = QString::fromLatin1(text, node.m_value.m_length);
+  }
+  return hasKey ? key + " : " + value : value;
+}
+
+QString JsonModel::keyText(int id) const
+{
+  int keyId = m_tree.m_nodes.at(id).m_keyId;
+  if (keyId < 0)
+  {
+    TextSpan span = m_tree.keySpan(id);
+    return JsonParser::decodeString(m_tree.sourceOf(id).constData() + span.m_offset, span.m_length);
+  }
+  // Ключ из таблицы декодируется один раз на документ: записи массива разделяют одну строку
+  if (keyId >= m_keyText.size())
+  {
+    m_keyText.resize(m_tree.m_keys.size());
+  }
+  QString &text = m_keyText[keyId];
+  if (text.isNull())
+  {
+    const QByteArray &key = m_tree.m_keys.key(keyId);
+    text = JsonParser::decodeString(key.constData(), key.size());
+  }
+  return text;
+}
+
 Qt::ItemFlags JsonModel::flags(const QModelIndex &index) const
 {
   if (!index.isValid())
@@ -396,19 +657,162 @@ QModelIndex JsonModel::rootIndex() const
   return index(0, 0);
 }
 
-Node* JsonModel::getNode(const QModelIndex &index) const
+int JsonModel::nodeId(const QModelIndex &index) const
 {
-  if (index.isValid())
+  return static_cast<int>(index.internalId());
+}
+
+QModelIndex JsonModel::indexOf(int id) const
+{
+  return createIndex(m_tree.m_nodes.at(id).m_row, 0, quintptr(id));
+}
+
+int JsonModel::extentStart(int id) const
+{
+  // Начало элемента в тексте вместе с ключом и кавычками
+  const Node &node = m_tree.m_nodes.at(id);
+  if (node.hasKey())
+  {
+    return m_tree.keySpan(id).m_offset - 1;
+  }
+  return node.m_type == NodeType::String ? node.m_value.m_offset - 1 : node.m_value.m_offset;
+}
+
+int JsonModel::extentEnd(int id) const
+{
+  const Node &node = m_tree.m_nodes.at(id);
+  int end = node.m_value.m_offset + node.m_value.m_length;
+  return node.m_type == NodeType::String ? end + 1 : end;
+}
+
+int JsonModel::enclosingContainer(int begin, int end) const
+{
+  // Спуск от корня по построенным контейнерам, скобки которых лежат вне участка [begin, end)
+  auto encloses = [this, begin, end](int id)
   {
-    return static_cast<Node*>(index.internalPointer());
+    const Node &node = m_tree.m_nodes.at(id);
+    bool isContainer = node.m_type == NodeType::Object || node.m_type == NodeType::Array;
+    return isContainer && node.childrenLoaded() && node.m_value.m_offset < begin
+           && node.m_value.m_offset + node.m_value.m_length - 1 >= end;
+  };
+  if (!encloses(0))
+  {
+    return -1;
+  }
+  int id = 0;
+  while (true)
+  {
+    // Последний ребенок, начинающийся до участка
+    int low = partitionPoint(0, m_tree.m_nodes.at(id).m_childCount, [this, id, begin](int row)
+    {
+      return extentStart(m_tree.childId(id, row)) < begin;
+    });
+    if (low == 0 || !encloses(m_tree.childId(id, low - 1)))
+    {
+      return id;
+    }
+    id = m_tree.childId(id, low - 1);
+  }
+}
+
+void JsonModel::setChildren(int id, const QVector<int> &ids)
+{
+  // Новый список детей пишется на место старого, если помещается, иначе в конец m_childIds
+  Node &node = m_tree.m_nodes[id];
+  if (ids.size() > node.m_childCount)
+  {
+    m_deadChildIds += node.m_childCount;
+    node.m_firstChild = m_tree.m_childIds.size();
+    m_tree.m_childIds.resize(m_tree.m_childIds.size() + ids.size());
+  }
+  node.m_childCount = ids.size();
+  for (int row = 0; row < ids.size(); ++row)
+  {
+    m_tree.m_childIds[node.m_firstChild + row] = ids.at(row);
+    m_tree.m_nodes[ids.at(row)].m_row = row;
+  }
+}
+
+void JsonModel::visitSubtree(int id, const std::function<void(int)> &visit)
+{
+  // Обход построенных узлов без рекурсии. Дети читаются после visit(),
+  // поэтому visit() может достроить их через materialize()
+  QVector<int> stack;
+  stack.append(id);
+  while (!stack.isEmpty())
+  {
+    int current = stack.takeLast();
+    visit(current);
+    const Node &node = m_tree.m_nodes.at(current);
+    if (!node.childrenLoaded())
+    {
+      continue;
+    }
+    for (int row = node.m_childCount - 1; row >= 0; --row)
+    {
+      stack.append(m_tree.childId(current, row));
+    }
+  }
+}
+
+void JsonModel::trackSubtree(int id, bool added)
+{
+  // Учет раскрывающихся узлов поддерева, которое появилось в модели или ушло из нее.
+  // Новые узлы свернуты (после сброса представление тоже все сворачивает),
+  // у удаленных раскрытие снимается, а сами они и их списки детей считаются мусором
+  visitSubtree(id, [this, added](int current)
+  {
+    Node &node = m_tree.m_nodes[current];
+    if (node.m_childCount > 0)
+    {
+      m_expandableCount += added ? 1 : -1;
+    }
+    if (isExpanded(node))
+    {
+      node.m_expandEpoch = 0;
+      m_expandedCount -= added ? 0 : 1;
+    }
+    if (!added)
+    {
+      m_deadNodes++;
+      m_deadChildIds += node.childrenLoaded() ? node.m_childCount : 0;
+    }
+  });
+}
+
+void JsonModel::shiftSpans(int id, int firstRow, int delta)
+{
+  // Текст после правки сдвинулся на delta: контейнер id и его предки меняют длину,
+  // а сдвигаются только поддеревья детей id начиная с firstRow и следующих соседей
+  // каждого предка. Узлы до правки и брошенные узлы не просматриваются
+  QVector<int> stack;
+  while (id >= 0)
+  {
+    Node &node = m_tree.m_nodes[id];
+    node.m_value.m_length += delta;
+    for (int row = node.m_childCount - 1; row >= firstRow; --row)
+    {
+      stack.append(m_tree.childId(id, row));
+    }
+    firstRow = node.m_row + 1;
+    id = node.m_parent;
+  }
+  while (!stack.isEmpty())
+  {
+    int current = stack.takeLast();
+    Node &node = m_tree.m_nodes[current];
+    node.m_value.m_offset += delta;
+    if (node.childrenLoaded())
+    {
+      for (int row = 0; row < node.m_childCount; ++row)
+      {
+        stack.append(m_tree.childId(current, row));
+      }
+    }
   }
-  return m_root;
 }
 
 void JsonModel::clear()
 {
-  beginResetModel();
-  delete m_root;
-  m_root = nullptr;
-  endResetModel();
+  setTree(JsonTree());
 }
@@ -0,0 +1,1209 @@
+#include "jsonparser.h"
+
+#include <QRunnable>
+#include <QThread>
+#include <QThreadPool>
+#include <cstring>
+
+// Как часто (в байтах входа) парсер сообщает о прогрессе и проверяет отмену.
+static const int kCheckpointBytes = 1 << 20;
+
+// Сколько байт проверяется побайтно, прежде чем перейти к маскам JsonScanner.
+static const int kScalarPrefix = 16;
+
+// Параллельный разбор включается для корневых контейнеров не меньше kParallelMinBytes,
+// на каждый поток приходится не меньше kMinChunkBytes входа.
+static const int kParallelMinBytes = 2 << 20;
+static const int kMinChunkBytes = 1 << 20;
+
+// Как часто ожидающий поток сообщает о прогрессе параллельного разбора.
+static const int kProgressIntervalMs = 50;
+
+// Родитель для значений внутри отложенного контейнера: узлы для них не создаются.
+static const int kSkippedNode = -2;
+
+const int JsonParser::kDefaultMaxDepth;
+const int JsonKeyTable::kMaxKeys;
+const int JsonKeyTable::kNotInterned;
+
+static inline bool isDigit(char c)
+{
+  return c >= '0' && c <= '9';
+}
+
+static inline bool isWhitespace(char c)
+{
+  return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+}
+
+static inline bool isStringSpecial(char c)
+{
+  return c == '"' || c == '\\' || static_cast<unsigned char>(c) < 0x20;
+}
+
+static inline bool isHexDigit(char c)
+{
+  return isDigit(c) || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F');
+}
+
+static inline int hexValue(char c)
+{
+  return isDigit(c) ? c - '0' : (c | 0x20) - 'a' + 10;
+}
+
+// Четыре шестнадцатеричные цифры \uXXXX; pos сдвигается только при успехе
+static bool readHex4(const char *&pos, const char *end, uint &code)
+{
+  if (end - pos < 4 || !isHexDigit(pos[0]) || !isHexDigit(pos[1]) || !isHexDigit(pos[2]) || !isHexDigit(pos[3]))
+  {
+    return false;
+  }
+  code = uint(hexValue(pos[0]) << 12 | hexValue(pos[1]) << 8 | hexValue(pos[2]) << 4 | hexValue(pos[3]));
+  pos += 4;
+  return true;
+}
+
+static void appendUtf8(QByteArray &out, uint code)
+{
+  if (code < 0x80)
+  {
+    out.append(char(code));
+  }
+  else if (code < 0x800)
+  {
+    out.append(char(0xC0 | (code >> 6)));
+    out.append(char(0x80 | (code & 0x3F)));
+  }
+  else if (code < 0x10000)
+  {
+    out.append(char(0xE0 | (code >> 12)));
+    out.append(char(0x80 | ((code >> 6) & 0x3F)));
+    out.append(char(0x80 | (code & 0x3F)));
+  }
+  else
+  {
+    out.append(char(0xF0 | (code >> 18)));
+    out.append(char(0x80 | ((code >> 12) & 0x3F)));
+    out.append(char(0x80 | ((code >> 6) & 0x3F)));
+    out.append(char(0x80 | (code & 0x3F)));
+  }
+}
+
+bool JsonParser::parse(const QByteArray &jsonBytes, JsonTree &tree)
+{
+  tree = JsonTree();
+  m_tree = &tree;
+  m_pending.clear();
+  m_stack.clear();
+  m_error = JsonParseError();
+  m_canceled = false;
+  m_nextCheckpoint = 0;
+  m_skipDepth = 0;
+  m_depthBase = 0;
+
+  tree.m_source = jsonBytes;
+  m_json = tree.m_source.constData();
+  m_size = tree.m_source.size();
+  m_scanner.reset(m_json, m_size);
+  int pos = skipWhitespace(0);
+  if (pos >= m_size)
+  {
+    setError(pos, QStringLiteral("Пустой документ"));
+  }
+  else if (!parseParallel(pos))
+  {
+    pos = parseValue(pos, -1);
+    if (!hasError())
+    {
+      pos = skipWhitespace(pos);
+      if (pos < m_size)
+      {
+        setError(pos, QStringLiteral("Лишние данные после корневого значения"));
+      }
+    }
+  }
+
+  m_pending.clear();
+  m_tree = nullptr;
+  if (hasError())
+  {
+    tree = JsonTree();
+    return false;
+  }
+  if (m_progressHandler)
+  {
+    m_progressHandler(m_size, m_size);
+  }
+  return true;
+}
+
+bool JsonParser::parse(const MappedFile &file, JsonTree &tree)
+{
+  if (file.isWindowed())
+  {
+    // Смещения узлов - int, поэтому окнами читается только JSON Lines
+    tree = JsonTree();
+    m_error = JsonParseError();
+    m_json = nullptr;
+    m_size = 0;
+    setError(0, QStringLiteral("Файл больше 2 ГБ можно открыть только как JSON Lines"));
+    return false;
+  }
+  if (!parse(file.bytes(), tree))
+  {
+    return false;
+  }
+  tree.m_file = file;
+  return true;
+}
+
+bool JsonParser::materialize(JsonTree &tree, int id)
+{
+  Node &node = tree.m_nodes[id];
+  if (node.childrenLoaded() || (node.m_type != NodeType::Object && node.m_type != NodeType::Array))
+  {
+    return true;
+  }
+
+  m_tree = &tree;
+  m_pending.clear();
+  m_stack.clear();
+  m_error = JsonParseError();
+  m_canceled = false;
+  m_nextCheckpoint = 0;
+  m_skipDepth = 0;
+  m_depthBase = 0;
+  const QByteArray &source = tree.sourceOf(id);
+  m_json = source.constData();
+  m_size = source.size();
+  m_scanner.reset(m_json, m_size);
+
+  // Текст уже проверен при загрузке, разбирается только один уровень:
+  // вложенные контейнеры снова откладываются
+  bool lazy = m_lazy;
+  m_lazy = true;
+  ContainerFrame frame;
+  frame.m_id = id;
+  frame.m_offset = node.m_value.m_offset;
+  frame.m_object = node.m_type == NodeType::Object;
+  m_stack.append(frame);
+  parseContainers(frame.m_offset + 1, 0);
+  m_lazy = lazy;
+
+  bool ok = !hasError();
+  m_stack.clear();
+  m_pending.clear();
+  m_tree = nullptr;
+  return ok;
+}
+
+void JsonParser::setThreadCount(int count)
+{
+  m_threadCount = count;
+}
+
+void JsonParser::setMaxDepth(int depth)
+{
+  m_maxDepth = depth;
+}
+
+void JsonParser::setLazy(bool lazy)
+{
+  m_lazy = lazy;
+}
+
+const JsonParseError &JsonParser::error() const
+{
+  return m_error;
+}
+
+bool JsonParser::wasCanceled() const
+{
+  return m_canceled;
+}
+
+void JsonParser::setCancelFlag(const QAtomicInt *flag)
+{
+  m_cancelFlag = flag;
+}
+
+void JsonParser::setProgressHandler(const std::function<void(qint64, qint64)> &handler)
+{
+  m_progressHandler = handler;
+}
+
+bool JsonParser::checkpoint(int pos)
+{
+  m_nextCheckpoint = pos + kCheckpointBytes;
+  if (m_cancelFlag && m_cancelFlag->loadAcquire())
+  {
+    m_canceled = true;
+    setError(pos, QStringLiteral("Загрузка отменена"));
+    return false;
+  }
+  if (m_progressHandler)
+  {
+    m_progressHandler(pos, m_size);
+  }
+  return true;
+}
+
+bool JsonParser::hasError() const
+{
+  return m_error.m_offset >= 0;
+}
+
+void JsonParser::setError(int pos, const QString &message)
+{
+  if (hasError())
+  {
+    return;
+  }
+  m_error.m_message = message;
+  m_error.m_offset = pos;
+
+  // Строка и столбец считаются только при ошибке, чтобы не замедлять разбор.
+  // Столбец - в символах, а не в байтах: продолжения UTF-8 не учитываются.
+  int lineStart = 0;
+  m_error.m_line = 1;
+  for (int i = 0; i < pos && i < m_size; ++i)
+  {
+    if (m_json[i] == '\n')
+    {
+      m_error.m_line++;
+      lineStart = i + 1;
+    }
+  }
+  m_error.m_column = 1;
+  for (int i = lineStart; i < pos && i < m_size; ++i)
+  {
+    if ((static_cast<unsigned char>(m_json[i]) & 0xC0) != 0x80)
+    {
+      m_error.m_column++;
+    }
+  }
+}
+
+int JsonParser::addItem(NodeType type, const TextSpan &key, const TextSpan &value, int parent)
+{
+  if (m_skipDepth > 0)
+  {
+    // Внутри отложенного контейнера считаются только его прямые дети
+    if (parent >= 0)
+    {
+      m_tree->m_nodes[parent].m_childCount++;
+    }
+    return kSkippedNode;
+  }
+
+  int id = m_tree->m_nodes.size();
+  Node node;
+  node.m_parent = parent;
+  if (key.m_offset >= 0)
+  {
+    node.m_keyId = m_tree->m_keys.intern(m_json + key.m_offset, key.m_length);
+  }
+  node.m_value = value;
+  node.m_type = type;
+  m_tree->m_nodes.append(node);
+
+  if (parent >= 0)
+  {
+    m_pending.append(id);
+  }
+  return id;
+}
+
+void JsonParser::closeContainer(int id, int firstPending)
+{
+  Node &node = m_tree->m_nodes[id];
+  node.m_firstChild = m_tree->m_childIds.size();
+  node.m_childCount = m_pending.size() - firstPending;
+  for (int i = firstPending; i < m_pending.size(); ++i)
+  {
+    int childId = m_pending.at(i);
+    m_tree->m_nodes[childId].m_row = i - firstPending;
+    m_tree->m_childIds.append(childId);
+  }
+  m_pending.resize(firstPending);
+}
+
+int JsonParser::skipWhitespace(int pos)
+{
+  // Короткие промежутки (отсутствие пробела, ", " или перевод строки с отступом)
+  // дешевле проверить побайтно, длинные пропускаются по маскам
+  int end = qMin(pos + kScalarPrefix, m_size);
+  for (; pos < end; ++pos)
+  {
+    if (!isWhitespace(m_json[pos]))
+    {
+      return pos;
+    }
+  }
+  return m_scanner.skipWhitespace(pos);
+}
+
+bool JsonParser::startsWith(int pos, const char *literal, int length) const
+{
+  return pos + length <= m_size && memcmp(m_json + pos, literal, length) == 0;
+}
+
+TextSpan JsonParser::parseString(int &pos)
+{
+  TextSpan span;
+  int start = pos;
+  pos++;
+  span.m_offset = pos;
+
+  // Начало строки проверяется побайтно: большинство ключей и значений короткие.
+  // Дальше обычные символы пропускаются по маскам первой стадии, а посимвольно
+  // разбираются только кавычки, escape-последовательности и управляющие символы
+  while (true)
+  {
+    int end = qMin(pos + kScalarPrefix, m_size);
+    while (pos < end && !isStringSpecial(m_json[pos]))
+    {
+      pos++;
+    }
+    if (pos == end)
+    {
+      pos = m_scanner.findStringSpecial(pos);
+    }
+    if (pos >= m_size)
+    {
+      break;
+    }
+
+    unsigned char c = static_cast<unsigned char>(m_json[pos]);
+    if (c == '"')
+    {
+      span.m_length = pos - span.m_offset;
+      pos++;
+      return span;
+    }
+    if (c == '\\')
+    {
+      pos++;
+      if (pos >= m_size)
+      {
+        break;
+      }
+      switch (m_json[pos])
+      {
+      case '"':
+      case '\\':
+      case '/':
+      case 'b':
+      case 'f':
+      case 'n':
+      case 'r':
+      case 't':
+        break;
+      case 'u':
+        for (int i = 1; i <= 4; ++i)
+        {
+          if (pos + i >= m_size || !isHexDigit(m_json[pos + i]))
+          {
+            setError(pos - 1, QStringLiteral("Некорректная последовательность \\u"));
+            return span;
+          }
+        }
+        pos += 4;
+        break;
+      default:
+        setError(pos - 1, QStringLiteral("Недопустимая escape-последовательность"));
+        return span;
+      }
+    }
+    else
+    {
+      setError(pos, QStringLiteral("Управляющий символ в строке"));
+      return span;
+    }
+    pos++;
+  }
+  setError(start, QStringLiteral("Незавершенная строка"));
+  return span;
+}
+
+QString JsonParser::decodeString(const char *data, int length)
+{
+  // Строка без escape-последовательностей преобразуется из UTF-8 целиком
+  const char *end = data + length;
+  const char *escape = static_cast<const char *>(std::memchr(data, '\\', size_t(length)));
+  if (!escape)
+  {
+    return QString::fromUtf8(data, length);
+  }
+
+  // Участки между escape-последовательностями копируются блоками, результат
+  // собирается в UTF-8 и преобразуется в QString один раз
+  QByteArray utf8;
+  utf8.reserve(length);
+  const char *run = data;
+  while (escape)
+  {
+    utf8.append(run, int(escape - run));
+    const char *pos = escape + 1;
+    if (pos == end)
+    {
+      run = end;
+      break;
+    }
+    char c = *pos++;
+    switch (c)
+    {
+    case 'b':
+      utf8.append('\b');
+      break;
+    case 'f':
+      utf8.append('\f');
+      break;
+    case 'n':
+      utf8.append('\n');
+      break;
+    case 'r':
+      utf8.append('\r');
+      break;
+    case 't':
+      utf8.append('\t');
+      break;
+    case 'u':
+    {
+      // Символы вне BMP записываются суррогатной парой \uD83D\uDE00;
+      // одиночная половина пары заменяется на U+FFFD
+      uint code = 0;
+      if (!readHex4(pos, end, code))
+      {
+        code = 0xFFFD;
+      }
+      else if (code >= 0xD800 && code <= 0xDBFF)
+      {
+        const char *next = pos + 2;
+        uint low = 0;
+        if (end - pos >= 6 && pos[0] == '\\' && pos[1] == 'u' && readHex4(next, end, low)
+            && low >= 0xDC00 && low <= 0xDFFF)
+        {
+          code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+          pos = next;
+        }
+        else
+        {
+          code = 0xFFFD;
+        }
+      }
+      else if (code >= 0xDC00 && code <= 0xDFFF)
+      {
+        code = 0xFFFD;
+      }
+      appendUtf8(utf8, code);
+      break;
+    }
+    default:
+      // \" \\ \/
+      utf8.append(c);
+      break;
+    }
+    run = pos;
+    escape = static_cast<const char *>(std::memchr(run, '\\', size_t(end - run)));
+  }
+  utf8.append(run, int(end - run));
+  return QString::fromUtf8(utf8);
+}
+
+TextSpan JsonParser::parseNumber(int &pos)
+{
+  TextSpan span;
+  span.m_offset = pos;
+  if (m_json[pos] == '-')
+  {
+    pos++;
+  }
+
+  if (pos < m_size && m_json[pos] == '0')
+  {
+    pos++;
+  }
+  else if (pos < m_size && isDigit(m_json[pos]))
+  {
+    while (pos < m_size && isDigit(m_json[pos]))
+    {
+      pos++;
+    }
+  }
+  else
+  {
+    setError(pos, QStringLiteral("Некорректное число"));
+    return span;
+  }
+
+  if (pos < m_size && m_json[pos] == '.')
+  {
+    pos++;
+    if (pos >= m_size || !isDigit(m_json[pos]))
+    {
+      setError(pos, QStringLiteral("Ожидается цифра после '.'"));
+      return span;
+    }
+    while (pos < m_size && isDigit(m_json[pos]))
+    {
+      pos++;
+    }
+  }
+
+  if (pos < m_size && (m_json[pos] == 'e' || m_json[pos] == 'E'))
+  {
+    pos++;
+    if (pos < m_size && (m_json[pos] == '+' || m_json[pos] == '-'))
+    {
+      pos++;
+    }
+    if (pos >= m_size || !isDigit(m_json[pos]))
+    {
+      setError(pos, QStringLiteral("Ожидается цифра в экспоненте"));
+      return span;
+    }
+    while (pos < m_size && isDigit(m_json[pos]))
+    {
+      pos++;
+    }
+  }
+
+  span.m_length = pos - span.m_offset;
+  return span;
+}
+
+TextSpan JsonParser::parseBoolNull(int &pos, NodeType &type)
+{
+  TextSpan span;
+  span.m_offset = pos;
+  if (startsWith(pos, "true", 4))
+  { 
+    type = NodeType::Bool;
+    span.m_length = 4;
+  }
+  else if (startsWith(pos, "false", 5))
+  {
+    type = NodeType::Bool;
+    span.m_length = 5;
+  }
+  else if (startsWith(pos, "null", 4))
+  {
+    type = NodeType::Null;
+    span.m_length = 4;
+  }
+  else
+  {
+    setError(pos, QStringLiteral("Неожиданный символ"));
+  }
+  pos += span.m_length;
+  return span;
+}
+
+int JsonParser::parseValue(int pos, int parent, const TextSpan &key)
+{
+  if (pos >= m_nextCheckpoint && !checkpoint(pos))
+  {
+    return pos;
+  }
+
+  pos = skipWhitespace(pos);
+  if (pos >= m_size)
+  {
+    setError(pos, QStringLiteral("Неожиданный конец данных"));
+    return pos;
+  }
+
+  if (m_json[pos] == '{' || m_json[pos] == '[')
+  {
+    int depth = m_stack.size();
+    pos = openContainer(pos, parent, key);
+    return hasError() ? pos : parseContainers(pos, depth);
+  }
+  return parseScalar(pos, parent, key);
+}
+
+int JsonParser::parseScalar(int pos, int parent, const TextSpan &key)
+{
+  char c = m_json[pos];
+  NodeType type = NodeType::Null;
+  TextSpan value;
+  if (c == '"') 
+  {
+    type = NodeType::String;
+    value = parseString(pos);
+  }
+  else if (isDigit(c) || c == '-')
+  {
+    type = NodeType::Number;
+    value = parseNumber(pos);
+  }
+  else
+  {
+    value = parseBoolNull(pos, type);
+  }
+
+  if (!hasError())
+  {
+    addItem(type, key, value, parent);
+  }
+  return pos;
+}
+
+int JsonParser::openContainer(int pos, int parent, const TextSpan &key)
+{
+  if (m_depthBase + m_stack.size() >= m_maxDepth)
+  {
+    setError(pos, QStringLiteral("Превышена максимальная глубина вложенности"));
+    return pos;
+  }
+  TextSpan value;
+  value.m_offset = pos;
+  bool isObject = m_json[pos] == '{';
+  int id = addItem(isObject ? NodeType::Object : NodeType::Array, key, value, parent);
+
+  // В ленивом режиме содержимое вложенных контейнеров только проверяется и считается,
+  // узлы для него строит materialize() при раскрытии
+  ContainerFrame frame;
+  frame.m_id = id;
+  frame.m_offset = pos;
+  frame.m_firstPending = m_pending.size();
+  frame.m_object = isObject;
+  frame.m_deferred = m_lazy && parent >= 0 && m_skipDepth == 0;
+  if (frame.m_deferred)
+  {
+    m_skipDepth++;
+  }
+  m_stack.append(frame);
+  return pos + 1;
+}
+
+int JsonParser::closeFrame(int pos)
+{
+  ContainerFrame frame = m_stack.takeLast();
+  if (frame.m_deferred)
+  {
+    m_skipDepth--;
+  }
+  if (frame.m_id < 0)
+  {
+    return pos;
+  }
+  m_tree->m_nodes[frame.m_id].m_value.m_length = pos - frame.m_offset;
+  if (frame.m_deferred)
+  {
+    m_tree->m_nodes[frame.m_id].m_firstChild = -1;
+  }
+  else
+  {
+    closeContainer(frame.m_id, frame.m_firstPending);
+  }
+  return pos;
+}
+
+int JsonParser::parseContainers(int pos, int depth)
+{
+  // Вложенность разбирается одним циклом по явному стеку контейнеров, а не рекурсией,
+  // поэтому глубина документа ограничена только m_maxDepth. pos указывает за открывающую
+  // скобку или за последнее значение контейнера на вершине стека; цикл идет, пока не
+  // закроются все контейнеры выше depth
+  bool opened = true;
+  bool afterValue = false;
+  while (m_stack.size() > depth)
+  {
+    pos = skipWhitespace(pos);
+    const ContainerFrame &frame = m_stack.last();
+    char close = frame.m_object ? '}' : ']';
+    if ((opened || afterValue) && pos < m_size && m_json[pos] == close)
+    {
+      pos = closeFrame(pos + 1);
+      opened = false;
+      afterValue = true;
+      continue;
+    }
+    if (afterValue)
+    {
+      if (pos >= m_size || m_json[pos] != ',')
+      {
+        setError(pos, frame.m_object ? QStringLiteral("Ожидается ',' или '}'")
+                                     : QStringLiteral("Ожидается ',' или ']'"));
+        return pos;
+      }
+      pos = skipWhitespace(pos + 1);
+    }
+
+    TextSpan key;
+    if (frame.m_object)
+    {
+      pos = parseKey(pos, key);
+      if (hasError())
+      {
+        return pos;
+      }
+    }
+    if (pos >= m_nextCheckpoint && !checkpoint(pos))
+    {
+      return pos;
+    }
+    pos = skipWhitespace(pos);
+    if (pos >= m_size)
+    {
+      setError(pos, QStringLiteral("Неожиданный конец данных"));
+      return pos;
+    }
+    if (m_json[pos] == '{' || m_json[pos] == '[')
+    {
+      pos = openContainer(pos, frame.m_id, key);
+      opened = true;
+      afterValue = false;
+    }
+    else
+    {
+      pos = parseScalar(pos, frame.m_id, key);
+      opened = false;
+      afterValue = true;
+    }
+    if (hasError())
+    {
+      return pos;
+    }
+  }
+  return pos;
+}
+
+int JsonParser::parseKey(int pos, TextSpan &key)
+{
+  if (pos >= m_size || m_json[pos] != '"')
+  {
+    setError(pos, QStringLiteral("Ожидается ключ объекта"));
+    return pos;
+  }
+  key = parseString(pos);
+  if (hasError())
+  {
+    return pos;
+  }
+
+  pos = skipWhitespace(pos);
+  if (pos >= m_size || m_json[pos] != ':')
+  {
+    setError(pos, QStringLiteral("Ожидается ':'"));
+    return pos;
+  }
+  return pos + 1;
+}
+
+int JsonParser::parseMember(int pos, int objId)
+{
+  TextSpan key;
+  pos = parseKey(pos, key);
+  return hasError() ? pos : parseValue(pos, objId, key);
+}
+
+// Часть корневого контейнера между двумя разделяющими запятыми и ее собственное дерево.
+struct JsonChunk
+{
+  int m_begin = 0;
+  int m_end = 0;
+  JsonTree m_tree;
+  bool m_ok = false;
+  bool m_canceled = false;
+};
+
+class JsonChunkTask : public QRunnable
+{
+public:
+  JsonChunkTask(const JsonParser &owner, NodeType type, JsonChunk &chunk, QAtomicInt &bytesDone)
+    : m_owner(owner), m_type(type), m_chunk(chunk), m_bytesDone(bytesDone)
+  {
+  }
+
+  void run() override
+  {
+    int reported = m_chunk.m_begin;
+    JsonParser parser;
+    parser.setLazy(m_owner.m_lazy);
+    parser.setMaxDepth(m_owner.m_maxDepth);
+    parser.setCancelFlag(m_owner.m_cancelFlag);
+    parser.setProgressHandler([this, &reported](qint64 done, qint64)
+    {
+      m_bytesDone.fetchAndAddRelaxed(int(done) - reported);
+      reported = int(done);
+    });
+    m_chunk.m_ok = parser.parseChunk(m_owner.m_tree->m_source, m_chunk.m_begin, m_chunk.m_end, m_type, m_chunk.m_tree);
+    m_chunk.m_canceled = parser.wasCanceled();
+    m_bytesDone.fetchAndAddRelaxed(m_chunk.m_end - reported);
+  }
+
+private:
+  const JsonParser &m_owner;
+  NodeType m_type;
+  JsonChunk &m_chunk;
+  QAtomicInt &m_bytesDone;
+};
+
+bool JsonParser::parseParallel(int rootPos)
+{
+  int threads = m_threadCount > 0 ? m_threadCount : QThread::idealThreadCount();
+  char c = m_json[rootPos];
+  if (threads < 2 || (c != '[' && c != '{') || m_size - rootPos < kParallelMinBytes)
+  {
+    return false;
+  }
+  int chunkCount = qMin(threads, (m_size - rootPos) / kMinChunkBytes);
+  int rootEnd = -1;
+  QVector<int> splits = splitTopLevel(rootPos, chunkCount, rootEnd);
+  // Части разбираются без закрывающей скобки корня, поэтому ее тип сверяется здесь.
+  // Невалидный документ разбирается последовательно, чтобы ошибка указывала на точное место
+  if (rootEnd < 0 || splits.isEmpty() || m_json[rootEnd] != (c == '[' ? ']' : '}')
+      || skipWhitespace(rootEnd + 1) < m_size)
+  {
+    return false;
+  }
+
+  QVector<JsonChunk> chunks(splits.size() + 1);
+  int begin = rootPos + 1;
+  for (int i = 0; i < chunks.size(); ++i)
+  {
+    chunks[i].m_begin = begin;
+    chunks[i].m_end = i < splits.size() ? splits.at(i) : rootEnd;
+    begin = chunks[i].m_end + 1;
+  }
+
+  NodeType type = c == '{' ? NodeType::Object : NodeType::Array;
+  QAtomicInt bytesDone(rootPos);
+  {
+    QThreadPool pool;
+    pool.setMaxThreadCount(chunks.size());
+    for (int i = 0; i < chunks.size(); ++i)
+    {
+      pool.start(new JsonChunkTask(*this, type, chunks[i], bytesDone));
+    }
+    while (!pool.waitForDone(kProgressIntervalMs))
+    {
+      if (m_progressHandler)
+      {
+        m_progressHandler(bytesDone.loadAcquire(), m_size);
+      }
+    }
+  }
+
+  for (const JsonChunk &chunk : chunks)
+  {
+    if (chunk.m_canceled)
+    {
+      m_canceled = true;
+      setError(chunk.m_begin, QStringLiteral("Загрузка отменена"));
+      return true;
+    }
+    if (!chunk.m_ok)
+    {
+      return false;
+    }
+  }
+
+  stitchChunks(chunks, type, rootPos, rootEnd);
+  return true;
+}
+
+QVector<int> JsonParser::splitTopLevel(int rootPos, int chunkCount, int &rootEnd)
+{
+  // Быстрый проход только по скобкам, запятым и строкам: ищет запятые первого уровня
+  // примерно через равные промежутки. Грамматика здесь не проверяется.
+  QVector<int> splits;
+  int step = (m_size - rootPos) / chunkCount;
+  int target = rootPos + step;
+  int depth = 0;
+  int pos = rootPos;
+  rootEnd = -1;
+  while ((pos = m_scanner.findStructuralOrQuote(pos)) < m_size)
+  {
+    char c = m_json[pos];
+    if (c == '"')
+    {
+      pos = m_scanner.findStringSpecial(pos + 1);
+      while (pos < m_size && m_json[pos] != '"')
+      {
+        pos = m_scanner.findStringSpecial(m_json[pos] == '\\' ? pos + 2 : pos + 1);
+      }
+    }
+    else if (c == '{' || c == '[')
+    {
+      depth++;
+    }
+    else if (c == '}' || c == ']')
+    {
+      if (--depth == 0)
+      {
+        rootEnd = pos;
+        break;
+      }
+    }
+    else if (c == ',' && depth == 1 && pos >= target)
+    {
+      splits.append(pos);
+      target = pos + step;
+    }
+    pos++;
+  }
+  return splits;
+}
+
+bool JsonParser::parseChunk(const QByteArray &source, int begin, int end, NodeType type, JsonTree &tree)
+{
+  tree = JsonTree();
+  m_tree = &tree;
+  m_pending.clear();
+  m_stack.clear();
+  m_error = JsonParseError();
+  m_canceled = false;
+  m_nextCheckpoint = begin;
+  m_skipDepth = 0;
+  m_depthBase = 1;
+
+  tree.m_source = source;
+  m_json = tree.m_source.constData();
+  m_size = end;
+  m_scanner.reset(m_json, m_size);
+
+  // Узел 0 временно заменяет корень: к нему цепляются элементы части
+  addItem(type, TextSpan(), TextSpan(), -1);
+  int pos = skipWhitespace(begin);
+  while (true)
+  {
+    pos = type == NodeType::Object ? parseMember(pos, 0) : parseValue(pos, 0);
+    if (hasError())
+    {
+      break;
+    }
+    pos = skipWhitespace(pos);
+    if (pos >= m_size)
+    {
+      closeContainer(0, 0);
+      break;
+    }
+    if (m_json[pos] != ',')
+    {
+      setError(pos, QStringLiteral("Ожидается ','"));
+      break;
+    }
+    pos = skipWhitespace(pos + 1);
+  }
+
+  m_pending.clear();
+  m_tree = nullptr;
+  return !hasError();
+}
+
+bool JsonParser::parseRange(const QByteArray &source, int begin, int end, NodeType type,
+                            bool leadingComma, bool trailingComma, JsonTree &part)
+{
+  part = JsonTree();
+  m_tree = &part;
+  m_pending.clear();
+  m_stack.clear();
+  m_error = JsonParseError();
+  m_canceled = false;
+  m_nextCheckpoint = begin;
+  m_skipDepth = 0;
+  m_depthBase = 1;
+
+  part.m_source = source;
+  m_json = part.m_source.constData();
+  m_size = end;
+  m_scanner.reset(m_json, m_size);
+
+  // Участок лежит между неизмененными соседями: после левого соседа идет запятая,
+  // затем элементы через запятую и запятая перед правым соседом. Элементов может не быть
+  addItem(type, TextSpan(), TextSpan(), -1);
+  bool needComma = leadingComma;
+  bool lastComma = false;
+  int count = 0;
+  int pos = skipWhitespace(begin);
+  while (pos < m_size)
+  {
+    if (needComma)
+    {
+      if (m_json[pos] != ',')
+      {
+        setError(pos, QStringLiteral("Ожидается ','"));
+        break;
+      }
+      needComma = false;
+      lastComma = true;
+      pos = skipWhitespace(pos + 1);
+      continue;
+    }
+    pos = type == NodeType::Object ? parseMember(pos, 0) : parseValue(pos, 0);
+    if (hasError())
+    {
+      break;
+    }
+    count++;
+    needComma = true;
+    lastComma = false;
+    pos = skipWhitespace(pos);
+  }
+
+  if (!hasError())
+  {
+    bool commaOk = trailingComma ? lastComma || (!leadingComma && count == 0) : !lastComma;
+    if (commaOk)
+    {
+      closeContainer(0, 0);
+    }
+    else
+    {
+      setError(pos, QStringLiteral("Ожидается ','"));
+    }
+  }
+
+  m_pending.clear();
+  m_tree = nullptr;
+  return !hasError();
+}
+
+void JsonParser::stitchChunks(QVector<JsonChunk> &chunks, NodeType type, int rootPos, int rootEnd)
+{
+  // Части переносятся в общее дерево по порядку, дети корня собираются из узлов 0 всех частей
+  JsonTree &tree = *m_tree;
+  int nodeCount = 1;
+  int childIdCount = 0;
+  for (const JsonChunk &chunk : chunks)
+  {
+    nodeCount += chunk.m_tree.m_nodes.size() - 1;
+    childIdCount += chunk.m_tree.m_childIds.size();
+  }
+  tree.m_nodes.reserve(nodeCount);
+  tree.m_childIds.reserve(childIdCount);
+
+  Node root;
+  root.m_type = type;
+  root.m_value.m_offset = rootPos;
+  root.m_value.m_length = rootEnd + 1 - rootPos;
+  tree.m_nodes.append(root);
+
+  QVector<int> rootChildren;
+  for (JsonChunk &chunk : chunks)
+  {
+    appendPart(tree, chunk.m_tree, 0, rootChildren);
+    chunk.m_tree = JsonTree();
+  }
+
+  tree.m_nodes[0].m_firstChild = tree.m_childIds.size();
+  tree.m_nodes[0].m_childCount = rootChildren.size();
+  tree.m_childIds += rootChildren;
+}
+
+void JsonParser::appendPart(JsonTree &tree, const JsonTree &part, int parentId, QVector<int> &rootChildren)
+{
+  // Узлы части дописываются в конец дерева со сдвигом индексов. Узел 0 части заменяет узел parentId:
+  // его дети становятся детьми parentId и продолжают нумерацию строк rootChildren
+  const Node &holder = part.m_nodes.at(0);
+  QVector<int> keyIds = tree.m_keys.merge(part.m_keys);
+  int nodeOffset = tree.m_nodes.size() - 1;
+  int childOffset = tree.m_childIds.size();
+  int rowOffset = rootChildren.size();
+
+  for (int i = 0; i < holder.m_firstChild; ++i)
+  {
+    tree.m_childIds.append(part.m_childIds.at(i) + nodeOffset);
+  }
+  for (int i = 1; i < part.m_nodes.size(); ++i)
+  {
+    Node node = part.m_nodes.at(i);
+    if (node.m_keyId >= 0)
+    {
+      node.m_keyId = keyIds.at(node.m_keyId);
+    }
+    if (node.m_parent == 0)
+    {
+      node.m_parent = parentId;
+      node.m_row += rowOffset;
+    }
+    else
+    {
+      node.m_parent += nodeOffset;
+    }
+    bool isContainer = node.m_type == NodeType::Object || node.m_type == NodeType::Array;
+    if (isContainer && node.childrenLoaded())
+    {
+      node.m_firstChild += childOffset;
+    }
+    tree.m_nodes.append(node);
+  }
+  for (int i = holder.m_firstChild; i < holder.m_firstChild + holder.m_childCount; ++i)
+  {
+    rootChildren.append(part.m_childIds.at(i) + nodeOffset);
+  }
+}
+
+void JsonParser::startLines(const QByteArray &source, JsonTree &tree)
+{
+  tree = JsonTree();
+  tree.m_source = source;
+  tree.m_lines = true;
+
+  Node root;
+  root.m_type = NodeType::Array;
+  root.m_value.m_offset = 0;
+  root.m_value.m_length = source.size();
+  tree.m_nodes.append(root);
+}
+
+bool JsonParser::parseLines(const QByteArray &source, int &pos, int maxBytes, JsonTree &batch)
+{
+  batch = JsonTree();
+  m_tree = &batch;
+  m_pending.clear();
+  m_stack.clear();
+  m_error = JsonParseError();
+  m_canceled = false;
+  m_nextCheckpoint = pos;
+  m_skipDepth = 0;
+  m_depthBase = 0;
+
+  batch.m_source = source;
+  m_json = batch.m_source.constData();
+  m_size = batch.m_source.size();
+  m_scanner.reset(m_json, m_size);
+
+  // Каждая непустая строка - отдельная запись, записи становятся детьми узла 0.
+  // Разбор останавливается на границе строки, когда прочитано не меньше maxBytes
+  addItem(NodeType::Array, TextSpan(), TextSpan(), -1);
+  int stop = maxBytes < m_size - pos ? pos + maxBytes : m_size;
+  pos = skipWhitespace(pos);
+  while (pos < stop)
+  {
+    int nodeCount = batch.m_nodes.size();
+    int childIdCount = batch.m_childIds.size();
+    int pendingCount = m_pending.size();
+    pos = parseValue(pos, 0);
+    if (hasError())
+    {
+      // Недописанная запись отбрасывается, предыдущие остаются в порции
+      batch.m_nodes.resize(nodeCount);
+      batch.m_childIds.resize(childIdCount);
+      m_pending.resize(pendingCount);
+      break;
+    }
+    while (pos < m_size && (m_json[pos] == ' ' || m_json[pos] == '\t' || m_json[pos] == '\r'))
+    {
+      pos++;
+    }
+    if (pos < m_size && m_json[pos] != '\n')
+    {
+      setError(pos, QStringLiteral("Ожидается перевод строки после записи"));
+      batch.m_nodes.resize(nodeCount);
+      batch.m_childIds.resize(childIdCount);
+      m_pending.resize(pendingCount);
+      break;
+    }
+    pos = skipWhitespace(pos);
+  }
+  closeContainer(0, 0);
+
+  m_pending.clear();
+  m_tree = nullptr;
+  return !hasError();
+}
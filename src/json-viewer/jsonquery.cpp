@@ -0,0 +1,407 @@
+#include "jsonquery.h"
+#include "jsonparser.h"
+
+#include <climits>
+#include <cstring>
+
+static inline bool isDigit(char c)
+{
+  return c >= '0' && c <= '9';
+}
+
+// Индекс массива из шага JSON Pointer: только десятичное число без ведущих нулей, иначе -1.
+static int pointerIndex(const QByteArray &token)
+{
+  if (token.isEmpty() || token.size() > 9 || (token.size() > 1 && token.at(0) == '0'))
+  {
+    return -1;
+  }
+  int value = 0;
+  for (char c : token)
+  {
+    if (!isDigit(c))
+    {
+      return -1;
+    }
+    value = value * 10 + (c - '0');
+  }
+  return value;
+}
+
+bool JsonQuery::compile(const QString &expression)
+{
+  m_steps.clear();
+  m_error.clear();
+  QByteArray text = expression.trimmed().toUtf8();
+  m_valid = text.isEmpty() || text.startsWith('/') ? compilePointer(text) : compilePath(text);
+  if (!m_valid)
+  {
+    m_steps.clear();
+  }
+  return m_valid;
+}
+
+bool JsonQuery::isValid() const
+{
+  return m_valid;
+}
+
+const QString &JsonQuery::errorString() const
+{
+  return m_error;
+}
+
+bool JsonQuery::hasDescendants() const
+{
+  for (const QueryStep &step : m_steps)
+  {
+    if (step.m_descendants)
+    {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool JsonQuery::setError(const QString &message, int pos)
+{
+  m_error = QStringLiteral("%1 (позиция %2)").arg(message).arg(pos + 1);
+  return false;
+}
+
+bool JsonQuery::compilePointer(const QByteArray &expression)
+{
+  // RFC 6901: пустая строка - весь документ, "~1" означает '/', "~0" - '~'
+  int pos = 0;
+  while (pos < expression.size())
+  {
+    int end = expression.indexOf('/', pos + 1);
+    if (end < 0)
+    {
+      end = expression.size();
+    }
+    QueryStep step;
+    step.m_kind = QueryStep::Token;
+    for (int i = pos + 1; i < end; ++i)
+    {
+      char c = expression.at(i);
+      if (c == '~')
+      {
+        char next = i + 1 < end ? expression.at(i + 1) : 0;
+        if (next != '0' && next != '1')
+        {
+          return setError(QStringLiteral("После '~' ожидается 0 или 1"), i);
+        }
+        step.m_key.append(next == '1' ? '/' : '~');
+        i++;
+        continue;
+      }
+      step.m_key.append(c);
+    }
+    step.m_index = pointerIndex(step.m_key);
+    m_steps.append(step);
+    pos = end;
+  }
+  return true;
+}
+
+bool JsonQuery::compilePath(const QByteArray &expression)
+{
+  const char *text = expression.constData();
+  int size = expression.size();
+  if (text[0] != '$')
+  {
+    return setError(QStringLiteral("Запрос начинается с '$' или '/'"), 0);
+  }
+
+  int pos = 1;
+  while (pos < size)
+  {
+    QueryStep step;
+    if (text[pos] == '.')
+    {
+      pos++;
+      if (pos < size && text[pos] == '.')
+      {
+        step.m_descendants = true;
+        pos++;
+      }
+      if (pos < size && text[pos] == '*')
+      {
+        step.m_kind = QueryStep::Wildcard;
+        pos++;
+        m_steps.append(step);
+        continue;
+      }
+      if (!(step.m_descendants && pos < size && text[pos] == '['))
+      {
+        int start = pos;
+        while (pos < size && text[pos] != '.' && text[pos] != '[')
+        {
+          pos++;
+        }
+        if (pos == start)
+        {
+          return setError(QStringLiteral("Ожидается имя ключа"), pos);
+        }
+        step.m_key = QByteArray(text + start, pos - start);
+        m_steps.append(step);
+        continue;
+      }
+    }
+    if (pos >= size || text[pos] != '[')
+    {
+      return setError(QStringLiteral("Ожидается '.' или '['"), pos);
+    }
+
+    // Скобки: ['ключ'], ["ключ"], [*], [n], [начало:конец]
+    pos++;
+    while (pos < size && text[pos] == ' ')
+    {
+      pos++;
+    }
+    if (pos < size && text[pos] == '*')
+    {
+      step.m_kind = QueryStep::Wildcard;
+      pos++;
+    }
+    else if (pos < size && (text[pos] == '\'' || text[pos] == '"'))
+    {
+      char quote = text[pos++];
+      while (pos < size && text[pos] != quote)
+      {
+        if (text[pos] == '\\' && pos + 1 < size)
+        {
+          pos++;
+        }
+        step.m_key.append(text[pos++]);
+      }
+      if (pos >= size)
+      {
+        return setError(QStringLiteral("Незакрытая кавычка"), pos);
+      }
+      pos++;
+    }
+    else
+    {
+      auto readInt = [text, size, &pos](int &value)
+      {
+        int start = pos;
+        bool negative = pos < size && text[pos] == '-';
+        if (negative)
+        {
+          pos++;
+        }
+        long long number = 0;
+        while (pos < size && isDigit(text[pos]) && number <= INT_MAX)
+        {
+          number = number * 10 + (text[pos++] - '0');
+        }
+        if (number > INT_MAX || pos == start + (negative ? 1 : 0))
+        {
+          pos = start;
+          return false;
+        }
+        value = int(negative ? -number : number);
+        return true;
+      };
+      step.m_kind = QueryStep::Index;
+      bool hasStart = readInt(step.m_index);
+      if (pos < size && text[pos] == ':')
+      {
+        pos++;
+        step.m_kind = QueryStep::Slice;
+        if (!hasStart)
+        {
+          step.m_index = 0;
+        }
+        if (!readInt(step.m_end))
+        {
+          step.m_end = INT_MAX;
+        }
+      }
+      else if (!hasStart)
+      {
+        return setError(QStringLiteral("Ожидается индекс, срез, '*' или ключ в кавычках"), pos);
+      }
+    }
+    while (pos < size && text[pos] == ' ')
+    {
+      pos++;
+    }
+    if (pos >= size || text[pos] != ']')
+    {
+      return setError(QStringLiteral("Ожидается ']'"), pos);
+    }
+    pos++;
+    m_steps.append(step);
+  }
+  return true;
+}
+
+QVector<int> JsonQuery::evaluate(const JsonTree &tree, const std::function<void(int)> &load) const
+{
+  QVector<int> current;
+  if (!m_valid || tree.isEmpty())
+  {
+    return current;
+  }
+  current.append(0);
+  // Узлы, уже пройденные шагом "..": если в current есть и предок, и его потомок,
+  // поддерево обходится один раз и результаты не повторяются
+  QVector<bool> visited;
+  for (const QueryStep &step : m_steps)
+  {
+    QVector<int> next;
+    QVector<int> stack;
+    KeyMatch match;
+    match.m_key = step.m_key;
+    match.m_text = QString::fromUtf8(step.m_key);
+    if (step.m_descendants)
+    {
+      visited.fill(false, tree.m_nodes.size());
+    }
+    for (int id : current)
+    {
+      if (!step.m_descendants)
+      {
+        load(id);
+        apply(tree, step, id, match, next);
+        continue;
+      }
+      // Сам узел и все его потомки в порядке документа, без рекурсии
+      stack.append(id);
+      while (!stack.isEmpty())
+      {
+        int nodeId = stack.takeLast();
+        // Ленивая загрузка дописывает узлы в конец массива дерева
+        if (nodeId >= visited.size())
+        {
+          visited.resize(tree.m_nodes.size());
+        }
+        if (visited.at(nodeId))
+        {
+          continue;
+        }
+        visited[nodeId] = true;
+        load(nodeId);
+        apply(tree, step, nodeId, match, next);
+        const Node &node = tree.m_nodes.at(nodeId);
+        if (!node.childrenLoaded())
+        {
+          continue;
+        }
+        for (int row = node.m_childCount - 1; row >= 0; --row)
+        {
+          stack.append(tree.childId(nodeId, row));
+        }
+      }
+    }
+    current.swap(next);
+    if (current.isEmpty())
+    {
+      break;
+    }
+  }
+  return current;
+}
+
+void JsonQuery::apply(const JsonTree &tree, const QueryStep &step, int id, KeyMatch &match, QVector<int> &result) const
+{
+  const Node &node = tree.m_nodes.at(id);
+  bool isObject = node.m_type == NodeType::Object;
+  bool isArray = node.m_type == NodeType::Array;
+  if ((!isObject && !isArray) || !node.childrenLoaded())
+  {
+    return;
+  }
+  int count = node.m_childCount;
+  auto clamp = [count](int value)
+  {
+    return value < 0 ? qMax(0, count + value) : qMin(value, count);
+  };
+
+  switch (step.m_kind)
+  {
+  case QueryStep::Wildcard:
+    for (int row = 0; row < count; ++row)
+    {
+      result.append(tree.childId(id, row));
+    }
+    break;
+  case QueryStep::Index:
+    if (isArray)
+    {
+      int row = step.m_index < 0 ? count + step.m_index : step.m_index;
+      if (row >= 0 && row < count)
+      {
+        result.append(tree.childId(id, row));
+      }
+    }
+    break;
+  case QueryStep::Slice:
+    if (isArray)
+    {
+      for (int row = clamp(step.m_index); row < clamp(step.m_end); ++row)
+      {
+        result.append(tree.childId(id, row));
+      }
+    }
+    break;
+  case QueryStep::Token:
+    // Шаг JSON Pointer: индекс для массива, ключ для объекта
+    if (isArray)
+    {
+      if (step.m_index >= 0 && step.m_index < count)
+      {
+        result.append(tree.childId(id, step.m_index));
+      }
+      break;
+    }
+    appendMembers(tree, id, match, result);
+    break;
+  case QueryStep::Key:
+    if (isObject)
+    {
+      appendMembers(tree, id, match, result);
+    }
+    break;
+  }
+}
+
+void JsonQuery::appendMembers(const JsonTree &tree, int id, KeyMatch &match, QVector<int> &result) const
+{
+  // Каждый ключ таблицы проверяется один раз за шаг, ключ вне таблицы - по тексту узла
+  for (int keyId = match.m_matches.size(); keyId < tree.m_keys.size(); ++keyId)
+  {
+    const QByteArray &key = tree.m_keys.key(keyId);
+    match.m_matches.append(matchesKey(match, key.constData(), key.size()));
+  }
+  const Node &node = tree.m_nodes.at(id);
+  for (int row = 0; row < node.m_childCount; ++row)
+  {
+    int childId = tree.childId(id, row);
+    int keyId = tree.m_nodes.at(childId).m_keyId;
+    bool matches = false;
+    if (keyId >= 0)
+    {
+      matches = match.m_matches.at(keyId);
+    }
+    else if (keyId == JsonKeyTable::kNotInterned)
+    {
+      TextSpan span = tree.keySpan(childId);
+      matches = matchesKey(match, tree.sourceOf(childId).constData() + span.m_offset, span.m_length);
+    }
+    if (matches)
+    {
+      result.append(childId);
+    }
+  }
+}
+
+bool JsonQuery::matchesKey(const KeyMatch &match, const char *key, int length)
+{
+  // Ключи без escape сравниваются побайтно, остальные - после декодирования
+  QByteArray raw = QByteArray::fromRawData(key, length);
+  return raw.contains('\\') ? JsonParser::decodeString(key, length) == match.m_text : raw == match.m_key;
+}
@@ -0,0 +1,253 @@
+#include "jsonscanner.h"
+
+#include <QAtomicInt>
+#include <QtAlgorithms>
+#include <cstring>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)) && defined(__SSE2__)
+#define JSONSCANNER_X86
+#include <immintrin.h>
+#endif
+
+typedef void (*ClassifyFunction)(const char *data, ScanBlock &block);
+
+static void classifyScalar(const char *data, ScanBlock &block)
+{
+  block = ScanBlock();
+  for (int i = 0; i < 64; ++i)
+  {
+    unsigned char c = static_cast<unsigned char>(data[i]);
+    quint64 bit = quint64(1) << i;
+    if (c == ' ' || c == '\n' || c == '\r' || c == '\t')
+    {
+      block.m_whitespace |= bit;
+    }
+    if (c == '"')
+    {
+      block.m_quote |= bit;
+    }
+    else if (c == '\\')
+    {
+      block.m_backslash |= bit;
+    }
+    if (c < 0x20)
+    {
+      block.m_control |= bit;
+    }
+    if (c == '{' || c == '}' || c == '[' || c == ']' || c == ',')
+    {
+      block.m_structural |= bit;
+    }
+  }
+}
+
+#ifdef JSONSCANNER_X86
+static void classifySse2(const char *data, ScanBlock &block)
+{
+  const __m128i space = _mm_set1_epi8(' ');
+  const __m128i newline = _mm_set1_epi8('\n');
+  const __m128i carriage = _mm_set1_epi8('\r');
+  const __m128i tab = _mm_set1_epi8('\t');
+  const __m128i quote = _mm_set1_epi8('"');
+  const __m128i backslash = _mm_set1_epi8('\\');
+  const __m128i controlMax = _mm_set1_epi8(0x1F);
+  const __m128i caseBit = _mm_set1_epi8(0x20);
+  const __m128i openBrace = _mm_set1_epi8('{');
+  const __m128i closeBrace = _mm_set1_epi8('}');
+  const __m128i comma = _mm_set1_epi8(',');
+
+  block = ScanBlock();
+  for (int i = 0; i < 4; ++i)
+  {
+    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i * 16));
+    __m128i ws = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, space), _mm_cmpeq_epi8(v, newline)),
+                              _mm_or_si128(_mm_cmpeq_epi8(v, carriage), _mm_cmpeq_epi8(v, tab)));
+    __m128i control = _mm_cmpeq_epi8(_mm_min_epu8(v, controlMax), v);
+    // '[' и ']' отличаются от '{' и '}' только битом 0x20
+    __m128i folded = _mm_or_si128(v, caseBit);
+    __m128i structural = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(folded, openBrace), _mm_cmpeq_epi8(folded, closeBrace)),
+                                      _mm_cmpeq_epi8(v, comma));
+    int shift = i * 16;
+    block.m_whitespace |= quint64(quint16(_mm_movemask_epi8(ws))) << shift;
+    block.m_quote |= quint64(quint16(_mm_movemask_epi8(_mm_cmpeq_epi8(v, quote)))) << shift;
+    block.m_backslash |= quint64(quint16(_mm_movemask_epi8(_mm_cmpeq_epi8(v, backslash)))) << shift;
+    block.m_control |= quint64(quint16(_mm_movemask_epi8(control))) << shift;
+    block.m_structural |= quint64(quint16(_mm_movemask_epi8(structural))) << shift;
+  }
+}
+
+__attribute__((target("avx2")))
+static void classifyAvx2(const char *data, ScanBlock &block)
+{
+  const __m256i space = _mm256_set1_epi8(' ');
+  const __m256i newline = _mm256_set1_epi8('\n');
+  const __m256i carriage = _mm256_set1_epi8('\r');
+  const __m256i tab = _mm256_set1_epi8('\t');
+  const __m256i quote = _mm256_set1_epi8('"');
+  const __m256i backslash = _mm256_set1_epi8('\\');
+  const __m256i controlMax = _mm256_set1_epi8(0x1F);
+  const __m256i caseBit = _mm256_set1_epi8(0x20);
+  const __m256i openBrace = _mm256_set1_epi8('{');
+  const __m256i closeBrace = _mm256_set1_epi8('}');
+  const __m256i comma = _mm256_set1_epi8(',');
+
+  block = ScanBlock();
+  for (int i = 0; i < 2; ++i)
+  {
+    __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + i * 32));
+    __m256i ws = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(v, space), _mm256_cmpeq_epi8(v, newline)),
+                                 _mm256_or_si256(_mm256_cmpeq_epi8(v, carriage), _mm256_cmpeq_epi8(v, tab)));
+    __m256i control = _mm256_cmpeq_epi8(_mm256_min_epu8(v, controlMax), v);
+    __m256i folded = _mm256_or_si256(v, caseBit);
+    __m256i structural = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(folded, openBrace), _mm256_cmpeq_epi8(folded, closeBrace)),
+                                         _mm256_cmpeq_epi8(v, comma));
+    int shift = i * 32;
+    block.m_whitespace |= quint64(quint32(_mm256_movemask_epi8(ws))) << shift;
+    block.m_quote |= quint64(quint32(_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, quote)))) << shift;
+    block.m_backslash |= quint64(quint32(_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, backslash)))) << shift;
+    block.m_control |= quint64(quint32(_mm256_movemask_epi8(control))) << shift;
+    block.m_structural |= quint64(quint32(_mm256_movemask_epi8(structural))) << shift;
+  }
+}
+#endif
+
+static QAtomicInt s_level(-1);
+
+static ClassifyFunction classifyFunction(JsonScanner::Level level)
+{
+#ifdef JSONSCANNER_X86
+  switch (level)
+  {
+  case JsonScanner::Avx2:
+    return classifyAvx2;
+  case JsonScanner::Sse2:
+    return classifySse2;
+  default:
+    break;
+  }
+#else
+  Q_UNUSED(level)
+#endif
+  return classifyScalar;
+}
+
+JsonScanner::Level JsonScanner::bestLevel()
+{
+#ifdef JSONSCANNER_X86
+  if (__builtin_cpu_supports("avx2"))
+  {
+    return Avx2;
+  }
+  return Sse2;
+#else
+  return Scalar;
+#endif
+}
+
+JsonScanner::Level JsonScanner::level()
+{
+  int current = s_level.loadAcquire();
+  if (current < 0)
+  {
+    current = bestLevel();
+    s_level.storeRelease(current);
+  }
+  return static_cast<Level>(current);
+}
+
+void JsonScanner::setLevel(Level level)
+{
+  s_level.storeRelease(qMin(level, bestLevel()));
+}
+
+void JsonScanner::classify(const char *data, int size, ScanBlock &block)
+{
+  ClassifyFunction function = classifyFunction(level());
+  if (size >= 64)
+  {
+    function(data, block);
+    return;
+  }
+  char tail[64];
+  memset(tail, 0, sizeof(tail));
+  memcpy(tail, data, qMax(size, 0));
+  function(tail, block);
+}
+
+void JsonScanner::reset(const char *data, int size)
+{
+  m_data = data;
+  m_size = size;
+  memset(m_tags, 0xFF, sizeof(m_tags));
+}
+
+void JsonScanner::fillBlock(int index)
+{
+  int slot = index & (kCacheBlocks - 1);
+  int offset = index << 6;
+  if (m_size - offset >= 64)
+  {
+    classifyFunction(level())(m_data + offset, m_cache[slot]);
+  }
+  else
+  {
+    classify(m_data + offset, m_size - offset, m_cache[slot]);
+  }
+  m_tags[slot] = index;
+}
+
+int JsonScanner::skipWhitespace(int pos)
+{
+  if (pos >= m_size)
+  {
+    return pos;
+  }
+  int index = pos >> 6;
+  quint64 mask = ~block(index).m_whitespace & (~quint64(0) << (pos & 63));
+  while (mask == 0)
+  {
+    mask = ~block(++index).m_whitespace;
+  }
+  return qMin((index << 6) + int(qCountTrailingZeroBits(mask)), m_size);
+}
+
+int JsonScanner::findStringSpecial(int pos)
+{
+  if (pos >= m_size)
+  {
+    return m_size;
+  }
+  int index = pos >> 6;
+  const ScanBlock *current = &block(index);
+  quint64 mask = (current->m_quote | current->m_backslash | current->m_control) & (~quint64(0) << (pos & 63));
+  while (mask == 0)
+  {
+    current = &block(++index);
+    mask = current->m_quote | current->m_backslash | current->m_control;
+  }
+  return qMin((index << 6) + int(qCountTrailingZeroBits(mask)), m_size);
+}
+
+int JsonScanner::findStructuralOrQuote(int pos)
+{
+  if (pos >= m_size)
+  {
+    return m_size;
+  }
+  // Переводы строк и прочие управляющие символы здесь не нужны: иначе отформатированный
+  // текст останавливал бы поиск на каждой строке. Поэтому конец данных проверяется по номеру блока
+  int index = pos >> 6;
+  int lastIndex = (m_size - 1) >> 6;
+  const ScanBlock *current = &block(index);
+  quint64 mask = (current->m_quote | current->m_structural) & (~quint64(0) << (pos & 63));
+  while (mask == 0)
+  {
+    if (index == lastIndex)
+    {
+      return m_size;
+    }
+    current = &block(++index);
+    mask = current->m_quote | current->m_structural;
+  }
+  return qMin((index << 6) + int(qCountTrailingZeroBits(mask)), m_size);
+}
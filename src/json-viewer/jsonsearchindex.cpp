@@ -0,0 +1,337 @@
+#include "jsonsearchindex.h"
+
+#include <QPair>
+#include <algorithm>
+
+static inline char foldCase(char c)
+{
+  return c >= 'A' && c <= 'Z' ? char(c - 'A' + 'a') : c;
+}
+
+static inline bool isTokenChar(char c)
+{
+  return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z')
+         || c == '.' || c == '+' || c == '-';
+}
+
+static inline quint32 trigram(const char *data)
+{
+  return (quint32(quint8(data[0])) << 16) | (quint32(quint8(data[1])) << 8) | quint8(data[2]);
+}
+
+static QByteArray folded(const char *data, int size)
+{
+  QByteArray text(data, size);
+  for (int i = 0; i < size; ++i)
+  {
+    text[i] = foldCase(data[i]);
+  }
+  return text;
+}
+
+// Токены участка [begin, end): содержимое строк (ключи и значения) и прочие скаляры. Текст уже
+// проверен парсером, поэтому хватает простого прохода: кавычка открывает строку, остальные символы
+// токенов - число или литерал. visit получает токен, приведенный к нижнему регистру, его смещение
+// и признак копии: токен без заглавных букв ссылается на исходный текст
+template <typename Visit>
+static void scanTokens(const char *data, int begin, int end, Visit visit)
+{
+  int pos = begin;
+  while (pos < end)
+  {
+    char c = data[pos];
+    int start = pos;
+    if (c == '"')
+    {
+      start = ++pos;
+      while (pos < end && data[pos] != '"')
+      {
+        pos += data[pos] == '\\' ? 2 : 1;
+      }
+    }
+    else if (isTokenChar(c))
+    {
+      while (pos < end && isTokenChar(data[pos]))
+      {
+        pos++;
+      }
+    }
+    else
+    {
+      pos++;
+      continue;
+    }
+
+    int length = qMin(pos, end) - start;
+    bool hasUpper = false;
+    for (int i = start; i < start + length && !hasUpper; ++i)
+    {
+      hasUpper = data[i] >= 'A' && data[i] <= 'Z';
+    }
+    visit(hasUpper ? folded(data + start, length) : QByteArray::fromRawData(data + start, length), start, hasUpper);
+    if (c == '"')
+    {
+      pos++;
+    }
+  }
+}
+
+void JsonSearchIndex::build(const QByteArray &source)
+{
+  clear();
+
+  QHash<QByteArray, int> ids;
+  QVector<int> tokenIds;
+  QVector<int> offsets;
+  scanTokens(source.constData(), 0, source.size(), [this, &ids, &tokenIds, &offsets](const QByteArray &key, int start, bool copied)
+  {
+    auto it = ids.constFind(key);
+    int id = 0;
+    if (it != ids.constEnd())
+    {
+      id = it.value();
+    }
+    else
+    {
+      id = m_tokens.size();
+      m_tokens.append(copied ? key : QByteArray(key.constData(), key.size()));
+      ids.insert(m_tokens.last(), id);
+    }
+    tokenIds.append(id);
+    offsets.append(start);
+  });
+
+  // Вхождения группируются по токенам подсчетом, внутри группы смещения идут по возрастанию
+  m_firstOccurrence.fill(0, m_tokens.size() + 1);
+  for (int id : tokenIds)
+  {
+    m_firstOccurrence[id + 1]++;
+  }
+  for (int i = 0; i < m_tokens.size(); ++i)
+  {
+    m_firstOccurrence[i + 1] += m_firstOccurrence[i];
+  }
+  m_occurrences.resize(offsets.size());
+  QVector<int> next = m_firstOccurrence;
+  for (int i = 0; i < offsets.size(); ++i)
+  {
+    m_occurrences[next[tokenIds.at(i)]++] = offsets.at(i);
+  }
+
+  for (int id = 0; id < m_tokens.size(); ++id)
+  {
+    addTrigrams(id);
+  }
+}
+
+void JsonSearchIndex::update(const QByteArray &source, int begin, int oldEnd, int newEnd)
+{
+  // Токены нового участка; различных токенов в правке немного, поэтому новые ищутся
+  // по триграммам, а не по хешу всех токенов, который пришлось бы хранить
+  QVector<QPair<int, int>> added;
+  scanTokens(source.constData(), begin, newEnd, [this, &added](const QByteArray &key, int start, bool copied)
+  {
+    int id = findToken(key);
+    if (id < 0)
+    {
+      id = m_tokens.size();
+      m_tokens.append(copied ? key : QByteArray(key.constData(), key.size()));
+      addTrigrams(id);
+    }
+    added.append(qMakePair(id, start));
+  });
+  std::sort(added.begin(), added.end());
+
+  // Вхождения перекладываются одним проходом: для каждого токена - смещения до участка,
+  // новые вхождения участка и сдвинутые смещения после него, порядок по возрастанию сохраняется
+  int delta = newEnd - oldEnd;
+  QVector<int> firstOccurrence(m_tokens.size() + 1);
+  QVector<int> occurrences;
+  occurrences.reserve(m_occurrences.size() + added.size());
+  int next = 0;
+  for (int id = 0; id < m_tokens.size(); ++id)
+  {
+    firstOccurrence[id] = occurrences.size();
+    // Токены, добавленные правкой, прежних вхождений не имеют
+    bool old = id + 1 < m_firstOccurrence.size();
+    int from = old ? m_firstOccurrence.at(id) : 0;
+    int to = old ? m_firstOccurrence.at(id + 1) : 0;
+    int i = from;
+    for (; i < to && m_occurrences.at(i) < begin; ++i)
+    {
+      occurrences.append(m_occurrences.at(i));
+    }
+    for (; next < added.size() && added.at(next).first == id; ++next)
+    {
+      occurrences.append(added.at(next).second);
+    }
+    for (; i < to; ++i)
+    {
+      int offset = m_occurrences.at(i);
+      if (offset >= oldEnd)
+      {
+        occurrences.append(offset + delta);
+      }
+    }
+  }
+  firstOccurrence[m_tokens.size()] = occurrences.size();
+  m_firstOccurrence = std::move(firstOccurrence);
+  m_occurrences = std::move(occurrences);
+}
+
+int JsonSearchIndex::findToken(const QByteArray &token) const
+{
+  if (token.size() >= 3)
+  {
+    auto it = m_trigrams.constFind(trigram(token.constData()));
+    if (it != m_trigrams.constEnd())
+    {
+      for (int id : it.value())
+      {
+        if (m_tokens.at(id) == token)
+        {
+          return id;
+        }
+      }
+    }
+    return -1;
+  }
+  for (int id = 0; id < m_tokens.size(); ++id)
+  {
+    if (m_tokens.at(id) == token)
+    {
+      return id;
+    }
+  }
+  return -1;
+}
+
+void JsonSearchIndex::addTrigrams(int id)
+{
+  const QByteArray &token = m_tokens.at(id);
+  for (int i = 0; i + 3 <= token.size(); ++i)
+  {
+    QVector<int> &list = m_trigrams[trigram(token.constData() + i)];
+    if (list.isEmpty() || list.last() != id)
+    {
+      list.append(id);
+    }
+  }
+}
+
+void JsonSearchIndex::clear()
+{
+  m_tokens.clear();
+  m_firstOccurrence.clear();
+  m_occurrences.clear();
+  m_trigrams.clear();
+}
+
+bool JsonSearchIndex::isEmpty() const
+{
+  return m_tokens.isEmpty();
+}
+
+int JsonSearchIndex::tokenCount() const
+{
+  return m_occurrences.size();
+}
+
+QVector<int> JsonSearchIndex::find(const QByteArray &text) const
+{
+  QVector<int> hits;
+  if (text.isEmpty())
+  {
+    return hits;
+  }
+  QByteArray needle = folded(text.constData(), text.size());
+
+  // Кандидаты - токены из самого короткого списка триграмм запроса;
+  // запрос короче трех символов проверяется по всем различным токенам
+  const QVector<int> *candidates = nullptr;
+  for (int i = 0; i + 3 <= needle.size(); ++i)
+  {
+    auto it = m_trigrams.constFind(trigram(needle.constData() + i));
+    if (it == m_trigrams.constEnd())
+    {
+      return hits;
+    }
+    if (!candidates || it.value().size() < candidates->size())
+    {
+      candidates = &it.value();
+    }
+  }
+
+  auto collect = [this, &needle, &hits](int id)
+  {
+    if (m_tokens.at(id).contains(needle))
+    {
+      for (int i = m_firstOccurrence.at(id); i < m_firstOccurrence.at(id + 1); ++i)
+      {
+        hits.append(m_occurrences.at(i));
+      }
+    }
+  };
+  if (candidates)
+  {
+    for (int id : *candidates)
+    {
+      collect(id);
+    }
+  }
+  else
+  {
+    for (int id = 0; id < m_tokens.size(); ++id)
+    {
+      collect(id);
+    }
+  }
+  std::sort(hits.begin(), hits.end());
+  return hits;
+}
+
+QByteArray JsonSearchIndex::escaped(const QByteArray &text)
+{
+  static const char kHex[] = "0123456789abcdef";
+  QByteArray result;
+  result.reserve(text.size());
+  for (char c : text)
+  {
+    switch (c)
+    {
+    case '"':
+      result += "\\\"";
+      break;
+    case '\\':
+      result += "\\\\";
+      break;
+    case '\b':
+      result += "\\b";
+      break;
+    case '\f':
+      result += "\\f";
+      break;
+    case '\n':
+      result += "\\n";
+      break;
+    case '\r':
+      result += "\\r";
+      break;
+    case '\t':
+      result += "\\t";
+      break;
+    default:
+      if (quint8(c) < 0x20)
+      {
+        result += "\\u00";
+        result += kHex[quint8(c) >> 4];
+        result += kHex[quint8(c) & 0xF];
+      }
+      else
+      {
+        result += c;
+      }
+    }
+  }
+  return result;
+}
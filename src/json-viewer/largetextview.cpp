@@ -0,0 +1,279 @@
+#include "largetextview.h"
+#include <climits>
+#include <QContextMenuEvent>
+#include <QFontDatabase>
+#include <QMenu>
+#include <QMouseEvent>
+#include <QPainter>
+#include <QScrollBar>
+
+namespace
+{
+  // Шаг сохраненных состояний лексера в длинной строке, байт
+  const int kStateStep = 64 << 10;
+  // Запас справа от видимой части: по нему строка перед ':' опознается как ключ
+  const int kLookahead = 256;
+
+  inline bool isContinuation(char c)
+  {
+    return (static_cast<uchar>(c) & 0xC0) == 0x80;
+  }
+}
+
+LargeTextView::LargeTextView(QWidget *parent) : QAbstractScrollArea(parent)
+{
+  setFont(QFontDatabase::systemFont(QFontDatabase::FixedFont));
+  m_lineHeight = fontMetrics().lineSpacing();
+  m_charWidth = fontMetrics().horizontalAdvance(QLatin1Char('0'));
+  viewport()->setCursor(Qt::IBeamCursor);
+}
+
+void LargeTextView::setSource(const QByteArray &source, const MappedFile &file)
+{
+  m_source = source;
+  m_file = file;
+  m_lines.build(m_source);
+  m_lineStates.clear();
+  m_anchorLine = m_selFirst = m_selLast = -1;
+  verticalScrollBar()->setValue(0);
+  horizontalScrollBar()->setValue(0);
+  updateScrollBars();
+  viewport()->update();
+}
+
+void LargeTextView::clear()
+{
+  m_lines.clear();
+  m_source.clear();
+  m_file = MappedFile();
+  m_lineStates.clear();
+  m_anchorLine = m_selFirst = m_selLast = -1;
+  updateScrollBars();
+  viewport()->update();
+}
+
+const QByteArray &LargeTextView::source() const
+{
+  return m_source;
+}
+
+void LargeTextView::showOffset(int offset)
+{
+  int line = m_lines.lineAt(offset);
+  if (line < 0)
+  {
+    return;
+  }
+  m_anchorLine = m_selFirst = m_selLast = line;
+  int page = verticalScrollBar()->pageStep();
+  if (line < verticalScrollBar()->value() || line >= verticalScrollBar()->value() + page)
+  {
+    verticalScrollBar()->setValue(line - page / 2);
+  }
+  viewport()->update();
+}
+
+void LargeTextView::updateScrollBars()
+{
+  // Прокрутка по вертикали идет построчно, по горизонтали - по столбцам:
+  // ширина длинной строки в пикселях не поместилась бы в int
+  int page = qMax(1, viewport()->height() / m_lineHeight);
+  verticalScrollBar()->setPageStep(page);
+  verticalScrollBar()->setRange(0, qMax(0, m_lines.lineCount() - page));
+  int columns = qMax(1, viewport()->width() / m_charWidth);
+  qint64 maxColumn = qint64(m_lines.maxLineLength()) + 1 - columns;
+  horizontalScrollBar()->setPageStep(columns);
+  horizontalScrollBar()->setSingleStep(1);
+  horizontalScrollBar()->setRange(0, int(qBound(qint64(0), maxColumn, qint64(INT_MAX))));
+}
+
+void LargeTextView::resizeEvent(QResizeEvent *event)
+{
+  QAbstractScrollArea::resizeEvent(event);
+  updateScrollBars();
+}
+
+int LargeTextView::lineAtY(int y) const
+{
+  int line = verticalScrollBar()->value() + y / m_lineHeight;
+  return qBound(0, line, m_lines.lineCount() - 1);
+}
+
+QColor LargeTextView::tokenColor(JsonToken::Kind kind) const
+{
+  // Те же цвета, что у JsonHighlighter
+  switch (kind)
+  {
+  case JsonToken::Key:
+    return Qt::darkBlue;
+  case JsonToken::String:
+    return Qt::darkGreen;
+  case JsonToken::Number:
+    return Qt::darkRed;
+  case JsonToken::Literal:
+    return Qt::darkYellow;
+  }
+  return palette().color(QPalette::Text);
+}
+
+int LargeTextView::lexState(int line, int offset)
+{
+  // Короткая строка просматривается от начала, для длинной состояния
+  // через каждые kStateStep байт считаются один раз
+  const char *data = m_source.constData();
+  const int start = m_lines.lineStart(line);
+  if (offset - start < kStateStep)
+  {
+    return JsonLexer::scan(data + start, offset - start, JsonLexer::Normal);
+  }
+  auto it = m_lineStates.find(line);
+  if (it == m_lineStates.end())
+  {
+    QVector<quint8> states;
+    const int end = m_lines.lineEnd(line);
+    int state = JsonLexer::Normal;
+    for (int pos = start; end - pos >= kStateStep; pos += kStateStep)
+    {
+      state = JsonLexer::scan(data + pos, kStateStep, state);
+      states.append(quint8(state));
+    }
+    it = m_lineStates.insert(line, states);
+  }
+  const int step = (offset - start) / kStateStep;
+  const int from = start + step * kStateStep;
+  return JsonLexer::scan(data + from, offset - from, it.value().at(step - 1));
+}
+
+void LargeTextView::paintEvent(QPaintEvent *)
+{
+  QPainter painter(viewport());
+  painter.fillRect(viewport()->rect(), palette().color(QPalette::Base));
+  if (m_lines.lineCount() == 0)
+  {
+    return;
+  }
+
+  const QFontMetrics metrics = fontMetrics();
+  const QColor textColor = palette().color(QPalette::Text);
+  const char *data = m_source.constData();
+  const int firstColumn = horizontalScrollBar()->value();
+  const int columns = viewport()->width() / m_charWidth + 2;
+  const int first = verticalScrollBar()->value();
+  const int last = qMin(m_lines.lineCount() - 1, first + viewport()->height() / m_lineHeight + 1);
+
+  for (int line = first; line <= last; ++line)
+  {
+    const int top = (line - first) * m_lineHeight;
+    if (line >= m_selFirst && line <= m_selLast)
+    {
+      painter.fillRect(0, top, viewport()->width(), m_lineHeight, palette().color(QPalette::Highlight).lighter(160));
+    }
+
+    // Строка раскрашивается независимо от соседних: в корректном JSON
+    // строковые литералы не переходят на следующую строку. Декодируются и разбираются
+    // только видимые столбцы с запасом; начало сдвигается к границе символа UTF-8
+    const int start = m_lines.lineStart(line);
+    const int lineEnd = m_lines.lineEnd(line);
+    if (lineEnd - start <= firstColumn)
+    {
+      continue;
+    }
+    int begin = start + firstColumn;
+    while (begin > start && isContinuation(data[begin]))
+    {
+      --begin;
+    }
+    int stop = begin + qMin(lineEnd - begin, columns + kLookahead);
+    while (stop < lineEnd && isContinuation(data[stop]))
+    {
+      ++stop;
+    }
+    const QString text = QString::fromUtf8(data + begin, stop - begin);
+    m_tokens.resize(0);
+    JsonLexer::tokenize(text, lexState(line, begin), m_tokens);
+
+    const int baseline = top + metrics.ascent();
+    int column = 0;
+    int x = (begin - start - firstColumn) * m_charWidth;
+    auto drawPart = [&](int end, const QColor &color)
+    {
+      if (end <= column)
+      {
+        return;
+      }
+      const QString part = text.mid(column, end - column);
+      painter.setPen(color);
+      painter.drawText(x, baseline, part);
+      x += metrics.horizontalAdvance(part);
+      column = end;
+    };
+    for (const JsonToken &token : m_tokens)
+    {
+      drawPart(token.m_start, textColor);
+      drawPart(token.m_start + token.m_length, tokenColor(token.m_kind));
+    }
+    drawPart(text.size(), textColor);
+  }
+}
+
+void LargeTextView::mousePressEvent(QMouseEvent *event)
+{
+  if (event->button() != Qt::LeftButton || m_lines.lineCount() == 0)
+  {
+    return;
+  }
+  int line = lineAtY(event->pos().y());
+  if (!(event->modifiers() & Qt::ShiftModifier) || m_anchorLine < 0)
+  {
+    m_anchorLine = line;
+  }
+  m_selFirst = qMin(m_anchorLine, line);
+  m_selLast = qMax(m_anchorLine, line);
+  viewport()->update();
+}
+
+void LargeTextView::mouseMoveEvent(QMouseEvent *event)
+{
+  if (!(event->buttons() & Qt::LeftButton) || m_anchorLine < 0)
+  {
+    return;
+  }
+  int line = lineAtY(event->pos().y());
+  m_selFirst = qMin(m_anchorLine, line);
+  m_selLast = qMax(m_anchorLine, line);
+  viewport()->update();
+}
+
+void LargeTextView::mouseDoubleClickEvent(QMouseEvent *event)
+{
+  mousePressEvent(event);
+  requestEdit();
+}
+
+void LargeTextView::contextMenuEvent(QContextMenuEvent *event)
+{
+  int line = lineAtY(event->pos().y());
+  if (m_lines.lineCount() == 0)
+  {
+    return;
+  }
+  if (line < m_selFirst || line > m_selLast)
+  {
+    m_anchorLine = m_selFirst = m_selLast = line;
+    viewport()->update();
+  }
+  QMenu menu(this);
+  QAction *edit = menu.addAction(tr("Изменить строки %1-%2").arg(m_selFirst + 1).arg(m_selLast + 1));
+  if (menu.exec(event->globalPos()) == edit)
+  {
+    requestEdit();
+  }
+}
+
+void LargeTextView::requestEdit()
+{
+  if (m_selFirst >= 0)
+  {
+    emit editRequested(m_lines.lineStart(m_selFirst), m_lines.lineEnd(m_selLast));
+  }
+}
@@ -0,0 +1,149 @@
+#include "loadprofile.h"
+#include <cstring>
+
+LoadProfile::Scope::Scope(LoadProfile &profile, const char *phase) : m_profile(profile), m_phase(phase)
+{
+  m_timer.start();
+}
+
+LoadProfile::Scope::~Scope()
+{
+  m_profile.addTime(m_phase, m_timer.nsecsElapsed());
+}
+
+void LoadProfile::clear()
+{
+  m_phases.clear();
+  m_counters.clear();
+  m_status = Ok;
+}
+
+bool LoadProfile::isEmpty() const
+{
+  return m_phases.isEmpty() && m_counters.isEmpty();
+}
+
+// Ключей меньше десятка, линейный поиск дешевле хеша
+qint64 *LoadProfile::find(QVector<Entry> &entries, const char *name)
+{
+  for (Entry &entry : entries)
+  {
+    if (std::strcmp(entry.m_name, name) == 0)
+    {
+      return &entry.m_value;
+    }
+  }
+  entries.append({ name, 0 });
+  return &entries.last().m_value;
+}
+
+qint64 LoadProfile::value(const QVector<Entry> &entries, const char *name)
+{
+  for (const Entry &entry : entries)
+  {
+    if (std::strcmp(entry.m_name, name) == 0)
+    {
+      return entry.m_value;
+    }
+  }
+  return 0;
+}
+
+void LoadProfile::addTime(const char *phase, qint64 ns)
+{
+  *find(m_phases, phase) += ns;
+}
+
+void LoadProfile::setCounter(const char *name, qint64 value)
+{
+  *find(m_counters, name) = value;
+}
+
+void LoadProfile::setStatus(Status status)
+{
+  m_status = status;
+}
+
+LoadProfile::Status LoadProfile::status() const
+{
+  return m_status;
+}
+
+void LoadProfile::merge(const LoadProfile &other)
+{
+  if (other.m_status != Ok)
+  {
+    m_status = other.m_status;
+  }
+  for (const Entry &entry : other.m_phases)
+  {
+    addTime(entry.m_name, entry.m_value);
+  }
+  for (const Entry &entry : other.m_counters)
+  {
+    setCounter(entry.m_name, entry.m_value);
+  }
+}
+
+qint64 LoadProfile::time(const char *phase) const
+{
+  return value(m_phases, phase);
+}
+
+qint64 LoadProfile::counter(const char *name) const
+{
+  return value(m_counters, name);
+}
+
+qint64 LoadProfile::totalTime() const
+{
+  qint64 total = 0;
+  for (const Entry &entry : m_phases)
+  {
+    total += entry.m_value;
+  }
+  return total;
+}
+
+QString LoadProfile::summary() const
+{
+  QString text;
+  switch (m_status)
+  {
+  case Ok:
+    text = "Загрузка";
+    break;
+  case Error:
+    text = "Ошибка загрузки,";
+    break;
+  case Canceled:
+    text = "Загрузка отменена,";
+    break;
+  }
+  text += QString(" %1 мс (").arg(totalTime() / 1000000);
+  for (int i = 0; i < m_phases.size(); ++i)
+  {
+    text += QString(i > 0 ? ", %1 %2" : "%1 %2").arg(m_phases.at(i).m_name).arg(m_phases.at(i).m_value / 1000000);
+  }
+  text += ")";
+  for (int i = 0; i < m_counters.size(); ++i)
+  {
+    text += QString(i > 0 ? ", %1 %2" : "; %1 %2").arg(m_counters.at(i).m_name).arg(m_counters.at(i).m_value);
+  }
+  return text;
+}
+
+QString LoadProfile::logLine() const
+{
+  static const char *const statuses[] = { "ok", "error", "canceled" };
+  QString text = QString("load status=%1 total_ms=%2").arg(statuses[m_status]).arg(totalTime() / 1e6, 0, 'f', 1);
+  for (const Entry &entry : m_phases)
+  {
+    text += QString(" %1_ms=%2").arg(entry.m_name).arg(entry.m_value / 1e6, 0, 'f', 1);
+  }
+  for (const Entry &entry : m_counters)
+  {
+    text += QString(" %1=%2").arg(entry.m_name).arg(entry.m_value);
+  }
+  return text;
+}
@@ -3,13 +3,14 @@
 #include <QMessageBox>
 #include <QFile>
 #include <QTextStream>
-#include <QJsonDocument>
 #include <QDebug>
-#include <QJsonArray>
-#include <QJsonObject>
 #include <QVBoxLayout>
 #include <QHBoxLayout>
 #include <QSplitter>
+#include <QScrollBar>
+#include <QInputDialog>
+#include <QStackedWidget>
+#include <QSet>
 
 
 MainWindow::MainWindow(QWidget *parent) : QMainWindow(parent) , ui(new Ui::MainWindow)
@@ -35,10 +36,22 @@ MainWindow::MainWindow(QWidget *parent) : QMainWindow(parent) , ui(new Ui::MainW
   buttonsLayout->addWidget(ui->updateButton);
  
   buttonsLayout->addStretch(); 
+  buttonsLayout->addWidget(ui->queryEdit);
+  buttonsLayout->addWidget(ui->searchEdit);
+  buttonsLayout->addWidget(ui->searchPrevButton);
+  buttonsLayout->addWidget(ui->searchNextButton);
+  buttonsLayout->addWidget(ui->searchLabel);
 
 
+  // Большие файлы показываются в отдельном представлении без копии текста в QTextDocument
+  m_largeView = new LargeTextView(this);
+  m_textStack = new QStackedWidget(this);
+  m_textStack->addWidget(ui->jsonTextEdit);
+  m_textStack->addWidget(m_largeView);
+  connect(m_largeView, &LargeTextView::editRequested, this, &MainWindow::onTextEditRequested);
+
   QSplitter *splitter = new QSplitter(Qt::Horizontal, this);
-  splitter->addWidget(ui->jsonTextEdit);
+  splitter->addWidget(m_textStack);
   splitter->addWidget(ui->jsonTreeView);
   
   splitter->setStretchFactor(0, 1);
@@ -62,47 +75,66 @@ MainWindow::MainWindow(QWidget *parent) : QMainWindow(parent) , ui(new Ui::MainW
 
 
   m_highlighter.setDocument(ui->jsonTextEdit->document());
+  // В режиме отложенной подсветки сначала форматируются видимые строки
+  connect(ui->jsonTextEdit->verticalScrollBar(), &QScrollBar::valueChanged, this, &MainWindow::updateVisibleBlocks);
+  connect(ui->jsonTextEdit->verticalScrollBar(), &QScrollBar::rangeChanged, this, &MainWindow::updateVisibleBlocks);
+  m_filter.setSourceModel(&m_model);
+
+
+  // Разбор идет в отдельном потоке, окно остается отзывчивым
+  statusBar()->addPermanentWidget(ui->loadProgressBar);
+  statusBar()->addPermanentWidget(ui->cancelButton);
+  setLoading(false);
+  // В дерево сразу попадает только верхний уровень, остальное строится при раскрытии
+  m_loader.setLazy(true);
+  connect(&m_loader, &JsonLoader::progressChanged, this, &MainWindow::onLoadProgress);
+  connect(&m_loader, &JsonLoader::finished, this, &MainWindow::onLoadFinished);
+  connect(&m_loader, &JsonLoader::recordsReady, this, &MainWindow::onRecordsReady);
+  connect(&m_loader, &JsonLoader::treeReady, this, &MainWindow::onTreeReady);
 }
 
 
 MainWindow::~MainWindow()
 {
+  m_loader.cancel();
+  m_loader.wait();
   delete ui;
 }
 
 
 void MainWindow::on_openButton_clicked()
 {
-  QString fileName = QFileDialog::getOpenFileName(this, tr("Выберить JSON-файл"), "", tr("JSON (*.json)"));
+  QString fileName = QFileDialog::getOpenFileName(this, tr("Выберить JSON-файл"), "",
+                                                  tr("JSON (*.json);;JSON Lines (*.jsonl *.ndjson)"));
     if (!fileName.isEmpty())
     {
-      QFile file(fileName);
-      if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) 
+      m_profile.clear();
+      MappedFile file;
+      bool opened = false;
+      {
+        LoadProfile::Scope scope(m_profile, "open");
+        opened = file.open(fileName);
+      }
+      if (!opened)
       {
+        qDebug() << "Ошибка открытия файла" << fileName << ":" << file.errorString();
+        m_profile.setStatus(LoadProfile::Error);
+        reportProfile(false);
         QMessageBox::warning(this, tr("Ошибка"), tr("Не возможно открыть файл: ") + fileName);
         return;
       }
-      QTextStream in(&file);
-      QString jsonString = in.readAll();
-      file.close();
-      QJsonDocument jsonDoc = QJsonDocument::fromJson(jsonString.toUtf8());
-      if (jsonDoc.isNull())
+      m_loadingFile = true;
+      m_windowed = file.isWindowed();
+      m_linesMode = fileName.endsWith(".jsonl", Qt::CaseInsensitive) || fileName.endsWith(".ndjson", Qt::CaseInsensitive);
+      setLoading(true);
+      if (m_linesMode)
       {
-        QMessageBox::warning(this, tr("Ошибка"), tr("Некорректный JSON формат"));
-        return;
+        m_loader.loadLines(file);
       }
-      ui->jsonTextEdit->setPlainText(jsonString);
-      if (m_model.rootIndex().isValid()) 
+      else
       {
-        m_model.clear();
+        m_loader.load(file);
       }
-
-      // ИСПРАВЛЕНИЕ: Используем loadJson для сохранения порядка
-      m_model.loadJson(jsonString.toUtf8());
-      
-      ui->jsonTreeView->setModel(&m_model);
-      ui->showButton->setIcon(QIcon(IMAGE_EXPAND_FILE_PATH));
-      ui->showButton->setText("Развернуть все");
     }
     else
     {
@@ -113,155 +145,446 @@ void MainWindow::on_openButton_clicked()
 
 void MainWindow::on_updateButton_clicked()
 {
-  QString jsonString = ui->jsonTextEdit->toPlainText();
-  QJsonDocument jsonDoc = QJsonDocument::fromJson(jsonString.toUtf8());
-  if (jsonDoc.isNull())
+  QByteArray text = ui->jsonTextEdit->toPlainText().toUtf8();
+  if (updateModelSource(text))
   {
-    QMessageBox::warning(this, tr("Ошибка"), tr("Некорректный JSON формат"));
     return;
   }
-  if (m_model.rootIndex().isValid())
+  m_loadingFile = false;
+  m_windowed = false;
+  m_profile.clear();
+  setLoading(true);
+  if (m_linesMode)
+  {
+    m_loader.loadLines(text);
+  }
+  else
+  {
+    m_loader.load(text);
+  }
+}
+
+
+void MainWindow::onTextEditRequested(int begin, int end)
+{
+  const QByteArray &source = m_largeView->source();
+  bool ok = false;
+  QString text = QInputDialog::getMultiLineText(this, tr("Правка фрагмента"), tr("Текст фрагмента:"),
+                                                QString::fromUtf8(source.constData() + begin, end - begin), &ok);
+  if (!ok || m_loader.isRunning())
+  {
+    return;
+  }
+  QByteArray updated = source.left(begin) + text.toUtf8() + source.mid(end);
+  // Представление переходит на новый текст раньше модели: обновленная модель
+  // отпускает отображение файла, на которое ссылался прежний текст
+  m_largeView->setSource(updated);
+  if (updateModelSource(updated))
+  {
+    m_largeView->showOffset(begin);
+    return;
+  }
+  // Правка не сводится к замене элементов: документ разбирается заново
+  m_loadingFile = true;
+  m_profile.clear();
+  setLoading(true);
+  if (m_linesMode)
+  {
+    m_loader.loadLines(updated);
+  }
+  else
   {
-    m_model.clear();
+    m_loader.load(updated);
   }
+}
 
-  // ИСПРАВЛЕНИЕ: Используем loadJson для сохранения порядка
-  m_model.loadJson(jsonString.toUtf8());
 
+bool MainWindow::updateModelSource(const QByteArray &text)
+{
+  // Небольшая правка применяется к модели на месте, без сброса раскрытых веток
+  int oldSize = m_model.source().size();
+  TextSpan replaced;
+  if (m_loader.isRunning() || !m_model.updateSource(text, &replaced))
+  {
+    return false;
+  }
+  // Индекс поиска обновляется только на разобранном заново участке, смещения после него сдвигаются
+  if (m_searchIndexValid && replaced.m_offset >= 0)
+  {
+    int oldEnd = replaced.m_offset + replaced.m_length;
+    m_searchIndex.update(m_model.source(), replaced.m_offset, oldEnd, oldEnd + text.size() - oldSize);
+  }
+  on_searchEdit_textChanged(ui->searchEdit->text());
+  updateShowButton();
+  return true;
+}
 
-  ui->jsonTreeView->setModel(&m_model);
-  ui->showButton->setIcon(QIcon(IMAGE_EXPAND_FILE_PATH));
-  ui->showButton->setText("Развернуть все");
+
+void MainWindow::on_cancelButton_clicked()
+{
+  m_loader.cancel();
+}
+
+
+void MainWindow::onLoadProgress(qint64 bytesDone, qint64 bytesTotal)
+{
+  ui->loadProgressBar->setValue(bytesTotal > 0 ? int(bytesDone * 100 / bytesTotal) : 100);
 }
 
 
-bool MainWindow::isTreeExpanded(const QModelIndex &index)
+void MainWindow::onRecordsReady()
 {
-  if (!ui->jsonTreeView->model()->hasChildren(index))
+  // Записи JSON Lines добавляются в модель порциями, уже загруженное можно просматривать
+  JsonTree tree;
+  if (m_loader.takeTree(tree))
   {
-    return true;
+    // Текст прежнего документа заменяется только в конце загрузки, до тех пор он не показывается
+    m_largeView->clear();
+    m_model.setTree(std::move(tree));
+    setTreeModel(&m_model);
   }
-  else
+  for (const JsonTree &batch : m_loader.takeBatches())
   {
-    if (!ui->jsonTreeView->isExpanded(index))
-    {
-      return false;
-    }
+    m_model.appendRecords(batch);
   }
-  int count = ui->jsonTreeView->model()->rowCount(index);
-  for (int i = 0; i < count; ++i)
+  updateShowButton();
+}
+
+
+void MainWindow::onLoadFinished()
+{
+  setLoading(false);
+  m_profile.merge(m_loader.profile());
+  m_searchIndexValid = m_loader.takeIndex(m_searchIndex);
+  on_searchEdit_textChanged(ui->searchEdit->text());
+  if (m_linesMode)
   {
-    QModelIndex childIndex = ui->jsonTreeView->model()->index(i, 0, index);
-    if (!isTreeExpanded(childIndex))
+    onRecordsReady();
+    if (m_loadingFile)
     {
-      return false;
+      setSourceTextProfiled(m_model.source(), m_model.file());
     }
   }
-  return true;
+  // Файл больше 2 ГБ читается окнами и целиком в памяти не лежит: текста и поиска для него нет
+  ui->searchEdit->setEnabled(!m_windowed);
+  ui->searchPrevButton->setEnabled(!m_windowed);
+  ui->searchNextButton->setEnabled(!m_windowed);
+  ui->updateButton->setEnabled(ui->updateButton->isEnabled() && !m_windowed);
+  // Записи JSON Lines до ошибки или отмены остаются показанными, а после неудачного
+  // разбора документа модель держит прежний документ
+  bool modelLoaded = m_linesMode || m_profile.status() == LoadProfile::Ok;
+  if (m_loader.wasCanceled())
+  {
+    qDebug() << "Загрузка отменена";
+    reportProfile(modelLoaded);
+    return;
+  }
+  if (!m_linesMode)
+  {
+    onTreeReady();
+  }
+  reportProfile(modelLoaded);
+  if (m_loader.error().m_offset >= 0)
+  {
+    showParseError(m_loader.error());
+  }
 }
 
 
-bool MainWindow::isTreeCollapsed(const QModelIndex &index)
+void MainWindow::onTreeReady()
 {
-  if (!ui->jsonTreeView->isExpanded(index))
+  // Дерево показывается сразу после разбора, индекс поиска еще строится
+  JsonTree tree;
+  if (!m_loader.takeTree(tree))
   {
-    return true;
+    return;
   }
-  int count = ui->jsonTreeView->model()->rowCount(index);
-  for (int i = 0; i < count; ++i)
+  if (m_loadingFile)
   {
-    QModelIndex childIndex = ui->jsonTreeView->model()->index(i, 0, index);
-    if (isTreeCollapsed(childIndex))
-    {
-      return true;
-    }
+    setSourceTextProfiled(tree.m_source, tree.m_file);
+  }
+
+  // Модель получает готовое дерево одним сбросом, дерево удерживает отображение файла
+  {
+    LoadProfile::Scope scope(m_profile, "model");
+    m_model.setTree(std::move(tree));
+  }
+  {
+    // Раскладка дерева выполняется сразу, а не при первой отрисовке, чтобы попасть в замер
+    LoadProfile::Scope scope(m_profile, "layout");
+    setTreeModel(&m_model);
+    ui->jsonTreeView->doItemsLayout();
   }
-  return false;
 }
 
 
-void MainWindow::expandAll(const QModelIndex &index)
+void MainWindow::setSourceTextProfiled(const QByteArray &source, const MappedFile &file)
 {
-  ui->jsonTreeView->expand(index);
-  int count = ui->jsonTreeView->model()->rowCount(index);
-  for (int i = 0; i < count; ++i)
+  // Подсветка небольшого документа выполняется внутри setPlainText,
+  // ее время вычитается из этапа текста и учитывается отдельно
+  m_highlighter.takeElapsed();
   {
-    QModelIndex childIndex = ui->jsonTreeView->model()->index(i, 0, index);
-    expandAll(childIndex);
+    LoadProfile::Scope scope(m_profile, "text");
+    setSourceText(source, file);
   }
+  qint64 highlight = m_highlighter.takeElapsed();
+  m_profile.addTime("text", -highlight);
+  m_profile.addTime("highlight", highlight);
 }
 
 
-void MainWindow::collapseAll(const QModelIndex &index)
+void MainWindow::reportProfile(bool modelLoaded)
 {
-  ui->jsonTreeView->collapse(index);
-  int count = ui->jsonTreeView->model()->rowCount(index);
-  for (int i = 0; i < count; ++i)
+  // Счетчики прежнего документа в замер неудачной загрузки не попадают
+  if (modelLoaded)
   {
-    QModelIndex childIndex = ui->jsonTreeView->model()->index(i, 0, index);
-    collapseAll(childIndex);
+    m_profile.setCounter("bytes", m_model.sourceSize());
+    m_profile.setCounter("nodes", m_model.nodeCount());
+    m_profile.setCounter("memory", m_model.memoryUsage());
   }
+  statusBar()->showMessage(m_profile.summary());
+  qDebug().noquote() << m_profile.logLine();
 }
 
 
-void MainWindow::on_showButton_clicked()
+void MainWindow::setSourceText(const QByteArray &source, const MappedFile &file)
 {
-  if (m_model.rowCount() != 0)
+  // Режим подсветки выбирается до замены текста: большой документ
+  // не должен форматироваться целиком внутри setPlainText
+  JsonHighlighter::Mode mode = m_highlighter.prepare(ui->jsonTextEdit->document(), source.size());
+  if (mode == JsonHighlighter::Plain)
   {
-    if (ui->showButton->text() == "Развернуть все")
-    {
-      for (int i = 0; i <= ui->jsonTreeView->model()->columnCount(); i++)
-      {
-        expandAll(ui->jsonTreeView->model()->index(0, i));
-      }
-      ui->showButton->setIcon(QIcon(IMAGE_COLLAPSE_FILE_PATH));
-      ui->showButton->setText("Свернуть все");
-    }
-    else
-    {
-      for (int i = 0; i <= ui->jsonTreeView->model()->columnCount(); i++)
-      {
-        collapseAll(ui->jsonTreeView->model()->index(0, i));
-      }
-      ui->showButton->setIcon(QIcon(IMAGE_EXPAND_FILE_PATH));
-      ui->showButton->setText("Развернуть все");
-    }
+    // Представление ссылается на те же байты, что и модель, и само удерживает отображение файла
+    ui->jsonTextEdit->clear();
+    m_largeView->setSource(source, file);
+    m_textStack->setCurrentWidget(m_largeView);
+  }
+  else
+  {
+    m_largeView->clear();
+    ui->jsonTextEdit->setPlainText(QString::fromUtf8(source));
+    m_textStack->setCurrentWidget(ui->jsonTextEdit);
+    m_highlighter.attach();
+    updateVisibleBlocks();
+  }
+  // Большой текст правится по фрагментам, а не целиком
+  ui->updateButton->setEnabled(mode != JsonHighlighter::Plain);
+}
+
+
+void MainWindow::updateVisibleBlocks()
+{
+  QWidget *viewport = ui->jsonTextEdit->viewport();
+  int first = ui->jsonTextEdit->cursorForPosition(QPoint(0, 0)).blockNumber();
+  int last = ui->jsonTextEdit->cursorForPosition(QPoint(viewport->width(), viewport->height())).blockNumber();
+  m_highlighter.setVisibleBlocks(first, last);
+}
+
+
+void MainWindow::setLoading(bool loading)
+{
+  // Поиск доступен, когда индекс готов
+  ui->openButton->setEnabled(!loading);
+  ui->searchEdit->setEnabled(!loading);
+  ui->searchPrevButton->setEnabled(!loading);
+  ui->searchNextButton->setEnabled(!loading);
+  ui->updateButton->setEnabled(!loading && m_textStack->currentWidget() == ui->jsonTextEdit);
+  ui->loadProgressBar->setValue(0);
+  ui->loadProgressBar->setVisible(loading);
+  ui->cancelButton->setVisible(loading);
+}
+
+
+void MainWindow::showParseError(const JsonParseError &error)
+{
+  qDebug() << "Ошибка разбора JSON:" << error.m_message
+           << "строка" << error.m_line << "столбец" << error.m_column << "смещение" << error.m_offset;
+  QMessageBox::warning(this, tr("Ошибка"), tr("Некорректный JSON формат: %1 (строка %2, столбец %3)")
+                       .arg(error.m_message).arg(error.m_line).arg(error.m_column));
+}
+
+
+void MainWindow::updateShowButton()
+{
+  if (m_model.allExpanded())
+  {
+    ui->showButton->setIcon(QIcon(IMAGE_COLLAPSE_FILE_PATH));
+    ui->showButton->setText("Свернуть все");
   }
   else
+  {
+    ui->showButton->setIcon(QIcon(IMAGE_EXPAND_FILE_PATH));
+    ui->showButton->setText("Развернуть все");
+  }
+}
+
+
+void MainWindow::on_showButton_clicked()
+{
+  if (m_model.rowCount() == 0)
   {
     QMessageBox::warning(this, tr("Ошибка"), tr("Дерево не содержит данных"));
     return;
   }
+  // Дерево раскрывается и сворачивается целиком за один проход раскладки,
+  // отдельные сигналы expanded/collapsed при этом не приходят
+  if (m_model.allExpanded())
+  {
+    ui->jsonTreeView->collapseAll();
+    m_model.setAllExpanded(false);
+  }
+  else
+  {
+    m_model.fetchAll();
+    ui->jsonTreeView->expandAll();
+    m_model.setAllExpanded(true);
+  }
+  updateShowButton();
 }
 
 
 void MainWindow::on_jsonTreeView_collapsed(const QModelIndex &index)
 {
-  bool check = true;
-  for (int i = 0; i < ui->jsonTreeView->model()->columnCount(); i++)
+  m_model.setExpanded(toSource(index), false);
+  updateShowButton();
+}
+
+
+void MainWindow::on_jsonTreeView_expanded(const QModelIndex &index)
+{
+  m_model.setExpanded(toSource(index), true);
+  updateShowButton();
+}
+
+
+void MainWindow::on_searchEdit_textChanged(const QString &)
+{
+  // Новый запрос выполняется по индексу при следующем переходе
+  m_searchHits.clear();
+  m_searchPos = -1;
+  ui->searchLabel->clear();
+}
+
+
+void MainWindow::on_searchEdit_returnPressed()
+{
+  showSearchHit(1);
+}
+
+
+void MainWindow::on_searchNextButton_clicked()
+{
+  showSearchHit(1);
+}
+
+
+void MainWindow::on_searchPrevButton_clicked()
+{
+  showSearchHit(-1);
+}
+
+
+void MainWindow::showSearchHit(int step)
+{
+  QString text = ui->searchEdit->text();
+  if (text.isEmpty() || m_model.rowCount() == 0)
   {
-    check = isTreeCollapsed(ui->jsonTreeView->model()->index(0, i));
-    if (!check)
+    return;
+  }
+  if (m_searchPos < 0)
+  {
+    if (!m_searchIndexValid)
     {
-      return;
+      m_searchIndex.build(m_model.source());
+      m_searchIndexValid = true;
     }
+    m_searchHits = m_searchIndex.find(JsonSearchIndex::escaped(text.toUtf8()));
+    m_searchPos = step > 0 ? -1 : 0;
+  }
+  if (m_searchHits.isEmpty())
+  {
+    ui->searchLabel->setText(tr("Не найдено"));
+    return;
+  }
+  m_searchPos = (m_searchPos + step + m_searchHits.size()) % m_searchHits.size();
+  ui->searchLabel->setText(tr("%1 из %2").arg(m_searchPos + 1).arg(m_searchHits.size()));
+
+  // Раскрывается только путь к найденному узлу, ветки достраиваются по пути
+  QModelIndex index = m_model.locate(m_searchHits.at(m_searchPos));
+  for (QModelIndex parent = index.parent(); parent.isValid(); parent = parent.parent())
+  {
+    ui->jsonTreeView->expand(toView(parent));
+  }
+  ui->jsonTreeView->setCurrentIndex(toView(index));
+  ui->jsonTreeView->scrollTo(toView(index));
+  if (m_textStack->currentWidget() == m_largeView)
+  {
+    m_largeView->showOffset(m_searchHits.at(m_searchPos));
   }
-   ui->showButton->setIcon(QIcon(IMAGE_EXPAND_FILE_PATH));
-   ui->showButton->setText("Развернуть все");
 }
 
 
-void MainWindow::on_jsonTreeView_expanded(const QModelIndex &index)
+void MainWindow::on_queryEdit_returnPressed()
 {
-  bool check = true;
-  for (int i = 0; i < ui->jsonTreeView->model()->columnCount(); i++)
+  // Пустой запрос возвращает полное дерево
+  QString text = ui->queryEdit->text().trimmed();
+  if (text.isEmpty())
   {
-    check = isTreeExpanded(ui->jsonTreeView->model()->index(0, i));
-    if (!check)
+    setTreeModel(&m_model);
+    return;
+  }
+  JsonQuery query;
+  if (!query.compile(text))
+  {
+    QMessageBox::warning(this, tr("Ошибка"), tr("Некорректный запрос: %1").arg(query.errorString()));
+    return;
+  }
+
+  QModelIndexList matches = m_model.query(query);
+  m_filter.setMatches(matches);
+  setTreeModel(&m_filter);
+  statusBar()->showMessage(tr("Найдено: %1").arg(matches.size()));
+
+  // Раскрывается путь к результатам, сами результаты остаются свернутыми
+  QSet<quintptr> expanded;
+  for (const QModelIndex &match : matches)
+  {
+    for (QModelIndex parent = match.parent(); parent.isValid(); parent = parent.parent())
     {
-      return;
+      if (expanded.contains(parent.internalId()))
+      {
+        break;
+      }
+      expanded.insert(parent.internalId());
+      ui->jsonTreeView->expand(m_filter.mapFromSource(parent));
     }
   }
-  ui->showButton->setIcon(QIcon(IMAGE_COLLAPSE_FILE_PATH));
-  ui->showButton->setText("Свернуть все");
+}
+
+
+void MainWindow::setTreeModel(QAbstractItemModel *model)
+{
+  // Представление при смене модели сворачивает все ветки; в модели это смена эпохи без обхода.
+  // В отфильтрованном дереве раскрываются только видимые строки, а счетчики модели
+  // относятся ко всему дереву, поэтому кнопка "развернуть все" там недоступна
+  if (model != &m_filter)
+  {
+    m_filter.clearMatches();
+  }
+  ui->jsonTreeView->setModel(model);
+  m_model.setAllExpanded(false);
+  ui->showButton->setEnabled(model != &m_filter);
+  updateShowButton();
+}
+
+
+QModelIndex MainWindow::toSource(const QModelIndex &index) const
+{
+  return ui->jsonTreeView->model() == &m_filter ? m_filter.mapToSource(index) : index;
+}
+
+
+QModelIndex MainWindow::toView(const QModelIndex &index) const
+{
+  return ui->jsonTreeView->model() == &m_filter ? m_filter.mapFromSource(index) : index;
 }
@@ -0,0 +1,97 @@
+#include "mappedfile.h"
+
+#include <limits>
+
+bool MappedFile::open(const QString &fileName, bool windowed)
+{
+  close();
+
+  QSharedPointer<QFile> file(new QFile(fileName));
+  if (!file->open(QIODevice::ReadOnly))
+  {
+    m_error = file->errorString();
+    return false;
+  }
+
+  // QByteArray адресует не больше 2 ГБ, такой файл читается окнами.
+  // Дескриптор остается открытым: окна отображаются по мере чтения
+  qint64 size = file->size();
+  if (windowed || size > std::numeric_limits<int>::max())
+  {
+    m_file = file;
+    m_size = size;
+    m_windowed = true;
+    return true;
+  }
+
+  if (size > 0)
+  {
+    uchar *data = file->map(0, size);
+    if (!data)
+    {
+      m_error = file->errorString();
+      return false;
+    }
+    m_data = reinterpret_cast<const char*>(data);
+  }
+
+  // Отображение остается действительным и после закрытия дескриптора,
+  // пока жив сам объект QFile.
+  file->close();
+  m_file = file;
+  m_size = size;
+  return true;
+}
+
+void MappedFile::close()
+{
+  m_file.reset();
+  m_data = nullptr;
+  m_size = 0;
+  m_windowed = false;
+  m_error.clear();
+}
+
+QByteArray MappedFile::bytes() const
+{
+  if (!m_data)
+  {
+    return QByteArray();
+  }
+  return QByteArray::fromRawData(m_data, static_cast<int>(m_size));
+}
+
+QByteArray MappedFile::window(qint64 offset, int size) const
+{
+  // Отображения окон снимаются вместе с QFile, то есть с последней копией объекта
+  if (!m_windowed || offset < 0 || size <= 0 || offset + size > m_size)
+  {
+    return QByteArray();
+  }
+  uchar *data = m_file->map(offset, size);
+  if (!data)
+  {
+    return QByteArray();
+  }
+  return QByteArray::fromRawData(reinterpret_cast<const char*>(data), size);
+}
+
+bool MappedFile::isWindowed() const
+{
+  return m_windowed;
+}
+
+qint64 MappedFile::size() const
+{
+  return m_size;
+}
+
+QString MappedFile::fileName() const
+{
+  return m_file ? m_file->fileName() : QString();
+}
+
+QString MappedFile::errorString() const
+{
+  return m_error;
+}
@@ -0,0 +1,66 @@
+#include "textlineindex.h"
+#include <algorithm>
+#include <cstring>
+
+void TextLineIndex::build(const QByteArray &text)
+{
+  clear();
+  m_data = text.constData();
+  m_size = text.size();
+  m_starts.append(0);
+  // memchr находит переводы строк быстрее посимвольного цикла
+  const char *begin = m_data;
+  const char *end = begin + m_size;
+  for (const char *pos = begin; pos < end; )
+  {
+    const char *newline = static_cast<const char *>(std::memchr(pos, '\n', size_t(end - pos)));
+    if (!newline)
+    {
+      break;
+    }
+    m_starts.append(int(newline - begin) + 1);
+    pos = newline + 1;
+  }
+  for (int line = 0; line < m_starts.size(); ++line)
+  {
+    m_maxLineLength = std::max(m_maxLineLength, lineEnd(line) - lineStart(line));
+  }
+}
+
+void TextLineIndex::clear()
+{
+  m_data = nullptr;
+  m_size = 0;
+  m_maxLineLength = 0;
+  m_starts.clear();
+}
+
+int TextLineIndex::lineCount() const
+{
+  return m_starts.size();
+}
+
+int TextLineIndex::lineStart(int line) const
+{
+  return m_starts[line];
+}
+
+int TextLineIndex::lineEnd(int line) const
+{
+  int end = line + 1 < m_starts.size() ? m_starts[line + 1] - 1 : m_size;
+  if (end > m_starts[line] && m_data[end - 1] == '\r')
+  {
+    --end;
+  }
+  return end;
+}
+
+int TextLineIndex::lineAt(int offset) const
+{
+  return int(std::upper_bound(m_starts.begin(), m_starts.end(), offset) - m_starts.begin()) - 1;
+}
+
+int TextLineIndex::maxLineLength() const
+{
+  return m_maxLineLength;
+}
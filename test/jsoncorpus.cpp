@@ -0,0 +1,159 @@
+#include "jsoncorpus.h"
+
+const int JsonCorpus::kKindCount;
+const int JsonCorpus::kDepth;
+
+namespace
+{
+  // xorshift32: быстрый и одинаковый везде
+  class Random
+  {
+  public:
+    explicit Random(quint32 seed) : m_state(seed ? seed : 1)
+    {
+    }
+
+    quint32 next()
+    {
+      m_state ^= m_state << 13;
+      m_state ^= m_state >> 17;
+      m_state ^= m_state << 5;
+      return m_state;
+    }
+
+    int below(int limit)
+    {
+      return int(next() % quint32(limit));
+    }
+
+  private:
+    quint32 m_state;
+  };
+
+  const char *const kWords[] = { "alpha", "beta", "gamma", "delta", "status", "value", "item", "user" };
+  const int kWordCount = sizeof(kWords) / sizeof(kWords[0]);
+
+  // Фрагменты строкового корпуса: экранирование, \u, суррогатная пара и UTF-8 без экранирования
+  const char *const kStringParts[] = {
+    "plain text ", "\\\"quoted\\\" ", "back\\\\slash ", "line\\nbreak ", "tab\\t ", "\\u00e9t\\u00e9 ",
+    "emoji \\ud83d\\ude00 ", "\xd0\xbf\xd1\x80\xd0\xb8\xd0\xb2\xd0\xb5\xd1\x82 ", "\\/slash ", "\\b\\f\\r "
+  };
+  const int kStringPartCount = sizeof(kStringParts) / sizeof(kStringParts[0]);
+
+  QByteArray number(Random &random)
+  {
+    switch (random.below(4))
+    {
+    case 0:
+      return QByteArray::number(random.below(1000));
+    case 1:
+      return QByteArray::number(int(random.next() >> 1) - 0x40000000);
+    case 2:
+      return QByteArray::number(random.below(1000000) / 1000.0, 'f', 3);
+    default:
+      return QByteArray::number(random.below(9) + 1) + "." + QByteArray::number(random.below(1000)) +
+          "e" + (random.below(2) ? "-" : "+") + QByteArray::number(random.below(300));
+    }
+  }
+
+  void appendRecord(QByteArray &json, Random &random, int id, bool pretty)
+  {
+    const char *indent = pretty ? "\n    " : " ";
+    json += pretty ? "  {" : "{";
+    json += indent;
+    json += "\"id\": " + QByteArray::number(id) + ",";
+    json += indent;
+    json += QByteArray("\"name\": \"") + kWords[random.below(kWordCount)] + " " + QByteArray::number(random.below(100000)) + "\",";
+    json += indent;
+    json += "\"score\": " + number(random) + ",";
+    json += indent;
+    json += QByteArray("\"active\": ") + (random.below(2) ? "true" : "false") + ",";
+    json += indent;
+    json += QByteArray("\"parent\": ") + (random.below(4) ? QByteArray::number(random.below(id + 1)) : QByteArray("null")) + ",";
+    json += indent;
+    json += "\"tags\": [";
+    const int tags = random.below(4);
+    for (int i = 0; i < tags; ++i)
+    {
+      json += QByteArray(i > 0 ? ", \"" : "\"") + kWords[random.below(kWordCount)] + "\"";
+    }
+    json += "]";
+    json += pretty ? "\n  }" : " }";
+  }
+
+  void appendDeep(QByteArray &json, Random &random, int depth)
+  {
+    for (int i = 0; i < depth; ++i)
+    {
+      json += i % 2 ? "{\"k\": " : "[";
+    }
+    json += number(random);
+    for (int i = depth - 1; i >= 0; --i)
+    {
+      json += i % 2 ? "}" : "]";
+    }
+  }
+
+  void appendString(QByteArray &json, Random &random)
+  {
+    json += "  \"";
+    const int parts = 4 + random.below(12);
+    for (int i = 0; i < parts; ++i)
+    {
+      json += kStringParts[random.below(kStringPartCount)];
+    }
+    json += "\"";
+  }
+}
+
+QByteArray JsonCorpus::generate(Kind kind, int bytes, quint32 seed)
+{
+  Random random(seed);
+  QByteArray json;
+  json.reserve(bytes + 1024);
+
+  if (kind == Lines)
+  {
+    for (int id = 0; json.size() < bytes; ++id)
+    {
+      appendRecord(json, random, id, false);
+      json += "\n";
+    }
+    return json;
+  }
+
+  json += kind == Keys ? "{\n" : "[\n";
+  for (int id = 0; json.size() < bytes; ++id)
+  {
+    if (id > 0)
+    {
+      json += kind == Numbers && id % 16 ? ", " : ",\n";
+    }
+    switch (kind)
+    {
+    case Records:
+      appendRecord(json, random, id, true);
+      break;
+    case Deep:
+      appendDeep(json, random, kDepth);
+      break;
+    case Strings:
+      appendString(json, random);
+      break;
+    case Keys:
+      json += QByteArray("  \"") + kWords[random.below(kWordCount)] + "_" + QByteArray::number(id) + "\": " + number(random);
+      break;
+    default:
+      json += number(random);
+      break;
+    }
+  }
+  json += kind == Keys ? "\n}\n" : "\n]\n";
+  return json;
+}
+
+const char *JsonCorpus::name(Kind kind)
+{
+  static const char *const names[] = { "records", "deep", "strings", "numbers", "lines", "keys" };
+  return names[kind];
+}
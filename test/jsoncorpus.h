@@ -0,0 +1,30 @@
+#ifndef JSONCORPUS_H
+#define JSONCORPUS_H
+
+#include <QByteArray>
+
+// Детерминированные синтетические документы для тестов производительности и замеров.
+// Одинаковые вид, размер и seed всегда дают один и тот же текст на любой платформе:
+// используется собственный генератор псевдослучайных чисел, а не std::*_distribution.
+class JsonCorpus
+{
+public:
+  enum Kind
+  {
+    Records,  // широкий массив отформатированных записей, как в выгрузках API
+    Deep,     // цепочки вложенных массивов и объектов глубиной kDepth
+    Strings,  // строки с escape-последовательностями, \uXXXX, суррогатными парами и UTF-8
+    Numbers,  // целые, дробные и экспоненциальные числа в компактной записи
+    Lines,    // JSON Lines: по одной компактной записи на строку
+    Keys      // объект-словарь: у каждого элемента свой ключ
+  };
+
+  static const int kKindCount = Keys + 1;
+  static const int kDepth = 256;
+
+  // Документ не короче bytes байт (превышение - не больше одной записи)
+  static QByteArray generate(Kind kind, int bytes, quint32 seed = 1);
+  static const char *name(Kind kind);
+};
+
+#endif // JSONCORPUS_H
@@ -1,7 +1,27 @@
 #include <gtest/gtest.h>
 #include <QByteArray>
 #include <QString>
+#include <QTemporaryFile>
+#include <QElapsedTimer>
+#include <QApplication>
+#include <QImage>
+#include <QScrollBar>
+#include <QTextBlock>
+#include <QTextDocument>
+#include <QTextLayout>
+#include "jsoncorpus.h"
 #include "jsonmodel.h"
+#include "jsonparser.h"
+#include "jsonquery.h"
+#include "jsonloader.h"
+#include "loadprofile.h"
+#include "jsonlexer.h"
+#include "jsonhighlighter.h"
+#include "largetextview.h"
+#include "jsonscanner.h"
+#include "jsonsearchindex.h"
+#include "textlineindex.h"
+#include "mappedfile.h"
 
 // ИСПРАВЛЕННЫЙ МАКРОС
 // Мы явно создаем QString из textStr перед передачей в функцию и перед выводом
@@ -260,3 +280,1538 @@ TEST(JsonModelTest, LoadJsonWithComplexNestedStructure)
   model.clear();
   EXPECT_EQ(model.rowCount(), 0);
 }
+
+TEST(JsonModelTest, ParentMatchesTraversalPath)
+{
+  JsonModel model;
+  QByteArray json = R"({
+    "a": [1, {"b": [true, false]}, 3],
+    "c": {"d": {"e": null}}
+  })";
+
+  ASSERT_TRUE(model.loadJson(json));
+
+  QVector<QModelIndex> stack;
+  stack.append(model.rootIndex());
+  int visited = 0;
+  while (!stack.isEmpty())
+  {
+    QModelIndex current = stack.takeLast();
+    ++visited;
+    for (int i = 0; i < model.rowCount(current); ++i)
+    {
+      QModelIndex child = model.index(i, 0, current);
+      ASSERT_TRUE(child.isValid());
+      EXPECT_EQ(child.row(), i);
+      EXPECT_EQ(model.parent(child), current);
+      stack.append(child);
+    }
+  }
+  EXPECT_EQ(visited, 11);
+  EXPECT_FALSE(model.parent(model.rootIndex()).isValid());
+
+  model.clear();
+  EXPECT_EQ(model.rowCount(), 0);
+}
+
+TEST(JsonModelTest, LoadJsonWithEscapedQuotesAndRootScalar)
+{
+  JsonModel model;
+  QByteArray json = R"({"say \"hi\"": "a \"quoted\" word", "n": null})";
+
+  ASSERT_TRUE(model.loadJson(json));
+
+  QModelIndex root = model.index(0, 0);
+  EXPECT_EQ(model.rowCount(root), 2);
+  EXPECT_HAS_ELEMENT(model, root, "say \"hi\" : \"a \"quoted\" word\"");
+  EXPECT_HAS_ELEMENT(model, root, "n : null");
+
+  ASSERT_TRUE(model.loadJson("  -12.5e3  "));
+  EXPECT_EQ(model.rowCount(), 1);
+  EXPECT_HAS_ELEMENT(model, QModelIndex(), "-12.5e3");
+
+  model.clear();
+  EXPECT_EQ(model.rowCount(), 0);
+}
+
+TEST(JsonModelTest, ParentRowInLargeArray)
+{
+  JsonModel model;
+  QByteArray json = "[";
+  for (int i = 0; i < 5000; ++i)
+  {
+    json += (i > 0 ? ",[" : "[") + QByteArray::number(i) + "]";
+  }
+  json += "]";
+
+  ASSERT_TRUE(model.loadJson(json));
+
+  QModelIndex root = model.rootIndex();
+  ASSERT_EQ(model.rowCount(root), 5000);
+  for (int i = 0; i < 5000; i += 499)
+  {
+    QModelIndex inner = model.index(0, 0, model.index(i, 0, root));
+    QModelIndex outer = model.parent(inner);
+    EXPECT_EQ(outer.row(), i);
+    EXPECT_EQ(model.parent(outer), root);
+    EXPECT_EQ(model.data(inner, Qt::DisplayRole).toString(), "0 : " + QString::number(i));
+  }
+}
+
+TEST(JsonModelTest, LoadJsonEmitsSingleReset)
+{
+  JsonModel model;
+  ASSERT_TRUE(model.loadJson(R"({"a": [1, 2, 3], "b": {"c": "d"}})"));
+
+  int resets = 0;
+  int aboutToReset = 0;
+  int inserts = 0;
+  int changes = 0;
+  QObject::connect(&model, &QAbstractItemModel::modelAboutToBeReset, [&]() { ++aboutToReset; });
+  QObject::connect(&model, &QAbstractItemModel::modelReset, [&]() { ++resets; });
+  QObject::connect(&model, &QAbstractItemModel::rowsInserted, [&](const QModelIndex &, int, int) { ++inserts; });
+  QObject::connect(&model, &QAbstractItemModel::dataChanged, [&](const QModelIndex &, const QModelIndex &) { ++changes; });
+
+  QByteArray json = "[";
+  for (int i = 0; i < 1000; ++i)
+  {
+    json += (i > 0 ? ",{\"id\": " : "{\"id\": ") + QByteArray::number(i) + "}";
+  }
+  json += "]";
+  ASSERT_TRUE(model.loadJson(json));
+
+  EXPECT_EQ(aboutToReset, 1);
+  EXPECT_EQ(resets, 1);
+  EXPECT_EQ(inserts, 0);
+  EXPECT_EQ(changes, 0);
+  EXPECT_EQ(model.rowCount(model.rootIndex()), 1000);
+
+  EXPECT_FALSE(model.loadJson("   "));
+  EXPECT_EQ(resets, 2);
+  EXPECT_EQ(model.rowCount(), 0);
+}
+
+TEST(JsonModelTest, LoadJsonWithUtf8Text)
+{
+  JsonModel model;
+  QByteArray json = u8R"({"имя": "Иван", "город": "Москва", "emoji": "😀", "pi": 3.14})";
+
+  ASSERT_TRUE(model.loadJson(json));
+
+  QModelIndex root = model.index(0, 0);
+  EXPECT_EQ(model.rowCount(root), 4);
+  EXPECT_HAS_ELEMENT(model, root, u8"имя : \"Иван\"");
+  EXPECT_HAS_ELEMENT(model, root, u8"город : \"Москва\"");
+  EXPECT_HAS_ELEMENT(model, root, u8"emoji : \"😀\"");
+  EXPECT_HAS_ELEMENT(model, root, "pi : 3.14");
+}
+
+TEST(JsonModelTest, LoadFileKeepsMappingAlive)
+{
+  QTemporaryFile tmp;
+  ASSERT_TRUE(tmp.open());
+  QByteArray json = R"({"name": "mapped", "items": [1, 2]})";
+  tmp.write(json);
+  tmp.close();
+
+  JsonModel model;
+  {
+    MappedFile file;
+    ASSERT_TRUE(file.open(tmp.fileName()));
+    EXPECT_EQ(file.size(), json.size());
+    ASSERT_TRUE(model.loadFile(file));
+  }
+
+  QModelIndex root = model.rootIndex();
+  EXPECT_EQ(model.rowCount(root), 2);
+  EXPECT_HAS_ELEMENT(model, root, "name : \"mapped\"");
+  EXPECT_HAS_ELEMENT(model, root, "items [2]");
+
+  MappedFile missing;
+  EXPECT_FALSE(missing.open(tmp.fileName() + ".missing"));
+  EXPECT_FALSE(missing.errorString().isEmpty());
+}
+
+TEST(JsonParserTest, RejectsMalformedInput)
+{
+  const char *invalid[] = {
+    "",
+    "{\"a\": 1,}",
+    "[1, 2,]",
+    "{\"a\" 1}",
+    "{a: 1}",
+    "[\"unterminated]",
+    "[01]",
+    "[1.]",
+    "[-]",
+    "[1e+]",
+    "[tru]",
+    "[\"bad \\x escape\"]",
+    "[\"bad \\u12G4\"]",
+    "[\"tab\tinside\"]",
+    "[1 2]",
+    "{} {}",
+    "[[]"
+  };
+
+  for (const char *json : invalid)
+  {
+    JsonParser parser;
+    JsonTree tree;
+    EXPECT_FALSE(parser.parse(QByteArray(json), tree)) << "Accepted: " << json;
+    EXPECT_TRUE(tree.isEmpty());
+    EXPECT_GE(parser.error().m_offset, 0);
+    EXPECT_FALSE(parser.error().m_message.isEmpty());
+  }
+}
+
+TEST(JsonParserTest, AcceptsValidInput)
+{
+  const char *valid[] = {
+    "0",
+    "-0.5e-10",
+    "\"\\u00e9\\n\\\"\"",
+    " [ ] ",
+    "{\"a\":{\"b\":[true,false,null,1E5]}}\r\n"
+  };
+
+  for (const char *json : valid)
+  {
+    JsonParser parser;
+    JsonTree tree;
+    EXPECT_TRUE(parser.parse(QByteArray(json), tree)) << "Rejected: " << json;
+    EXPECT_EQ(parser.error().m_offset, -1);
+  }
+}
+
+TEST(JsonParserTest, ReportsErrorPosition)
+{
+  JsonParser parser;
+  JsonTree tree;
+  QByteArray json = u8"{\n  \"имя\": \"Иван\",\n  \"возраст\" 30\n}";
+
+  ASSERT_FALSE(parser.parse(json, tree));
+  EXPECT_EQ(parser.error().m_offset, json.indexOf("30"));
+  EXPECT_EQ(parser.error().m_line, 3);
+  EXPECT_EQ(parser.error().m_column, 13);
+}
+
+TEST(JsonParserTest, ReportsProgressAndHonorsCancel)
+{
+  QByteArray json = "[" + QByteArray("1,").repeated(1 << 20) + "1]";
+  QVector<qint64> progress;
+  JsonParser parser;
+  JsonTree tree;
+  parser.setProgressHandler([&progress, &json](qint64 done, qint64 total)
+  {
+    EXPECT_EQ(total, json.size());
+    progress.append(done);
+  });
+
+  ASSERT_TRUE(parser.parse(json, tree));
+  ASSERT_GE(progress.size(), 2);
+  for (int i = 1; i < progress.size(); ++i)
+  {
+    EXPECT_LE(progress.at(i - 1), progress.at(i));
+  }
+  EXPECT_EQ(progress.last(), json.size());
+
+  QAtomicInt cancel(1);
+  parser.setCancelFlag(&cancel);
+  EXPECT_FALSE(parser.parse(json, tree));
+  EXPECT_TRUE(parser.wasCanceled());
+  EXPECT_TRUE(tree.isEmpty());
+}
+
+TEST(JsonLoaderTest, LoadsTreeOnWorkerThread)
+{
+  JsonLoader loader;
+  loader.load(QByteArray("{\"a\": [1, 2]}"));
+  ASSERT_TRUE(loader.wait(10000));
+  EXPECT_FALSE(loader.wasCanceled());
+
+  JsonTree tree;
+  ASSERT_TRUE(loader.takeTree(tree));
+  EXPECT_FALSE(loader.takeTree(tree));
+
+  JsonModel model;
+  model.setTree(std::move(tree));
+  QModelIndex root = model.rootIndex();
+  ASSERT_EQ(model.rowCount(root), 1);
+  EXPECT_EQ(model.data(model.index(0, 0, root), Qt::DisplayRole).toString(), "a [2]");
+
+  loader.load(QByteArray("{\"a\": }"));
+  ASSERT_TRUE(loader.wait(10000));
+  EXPECT_FALSE(loader.takeTree(tree));
+  EXPECT_EQ(loader.error().m_offset, 6);
+}
+
+TEST(JsonModelTest, LazyLoadFetchesChildrenOnDemand)
+{
+  JsonParser parser;
+  parser.setLazy(true);
+  JsonTree tree;
+  ASSERT_TRUE(parser.parse(QByteArray("{\"a\": [1, {\"b\": [true]}], \"c\": {}, \"d\": 5}"), tree));
+  EXPECT_EQ(tree.m_nodes.size(), 4);
+
+  JsonTree invalid;
+  EXPECT_FALSE(parser.parse(QByteArray("{\"a\": [1, {\"b\": ]}]}"), invalid));
+
+  JsonModel model;
+  model.setTree(std::move(tree));
+  int inserts = 0;
+  QObject::connect(&model, &QAbstractItemModel::rowsInserted, [&](const QModelIndex &, int, int) { ++inserts; });
+
+  QModelIndex root = model.rootIndex();
+  ASSERT_EQ(model.rowCount(root), 3);
+  QModelIndex a = model.index(0, 0, root);
+  EXPECT_EQ(model.data(a, Qt::DisplayRole).toString(), "a [2]");
+  EXPECT_EQ(model.rowCount(a), 0);
+  EXPECT_TRUE(model.hasChildren(a));
+  EXPECT_TRUE(model.canFetchMore(a));
+  EXPECT_FALSE(model.hasChildren(model.index(1, 0, root)));
+  EXPECT_FALSE(model.canFetchMore(model.index(1, 0, root)));
+
+  model.fetchMore(a);
+  EXPECT_EQ(inserts, 1);
+  EXPECT_FALSE(model.canFetchMore(a));
+  ASSERT_EQ(model.rowCount(a), 2);
+  EXPECT_EQ(model.data(model.index(0, 0, a), Qt::DisplayRole).toString(), "0 : 1");
+
+  QModelIndex inner = model.index(1, 0, a);
+  EXPECT_EQ(model.data(inner, Qt::DisplayRole).toString(), "1 {1}");
+  EXPECT_EQ(model.parent(inner), a);
+  model.fetchMore(inner);
+  QModelIndex b = model.index(0, 0, inner);
+  EXPECT_EQ(model.data(b, Qt::DisplayRole).toString(), "b [1]");
+  model.fetchMore(b);
+  EXPECT_EQ(model.data(model.index(0, 0, b), Qt::DisplayRole).toString(), "0 : true");
+  EXPECT_EQ(model.parent(model.index(0, 0, b)), b);
+}
+
+TEST(JsonScannerTest, SimdLevelsMatchScalar)
+{
+  QByteArray text;
+  for (int i = 0; i < 300; ++i)
+  {
+    text.append(static_cast<char>((i * 37) % 256));
+  }
+  text.append(" \t\r\n\"\\abc\x7f\x1f");
+
+  JsonScanner::Level best = JsonScanner::bestLevel();
+  for (int offset = 0; offset < text.size(); offset += 64)
+  {
+    int size = qMin(64, text.size() - offset);
+    JsonScanner::setLevel(JsonScanner::Scalar);
+    ScanBlock expected;
+    JsonScanner::classify(text.constData() + offset, size, expected);
+    for (int level = JsonScanner::Sse2; level <= best; ++level)
+    {
+      JsonScanner::setLevel(static_cast<JsonScanner::Level>(level));
+      ScanBlock block;
+      JsonScanner::classify(text.constData() + offset, size, block);
+      EXPECT_EQ(block.m_whitespace, expected.m_whitespace) << "level " << level << " offset " << offset;
+      EXPECT_EQ(block.m_quote, expected.m_quote) << "level " << level << " offset " << offset;
+      EXPECT_EQ(block.m_backslash, expected.m_backslash) << "level " << level << " offset " << offset;
+      EXPECT_EQ(block.m_control, expected.m_control) << "level " << level << " offset " << offset;
+      EXPECT_EQ(block.m_structural, expected.m_structural) << "level " << level << " offset " << offset;
+    }
+  }
+  JsonScanner::setLevel(best);
+}
+
+TEST(JsonScannerTest, StructuralSearchSkipsLineBreaks)
+{
+  QByteArray text = "[\n" + QByteArray(100, ' ') + "\n\t1\n" + QByteArray(70, '\n') + "\"a\"\n]\n\n";
+  for (int level = JsonScanner::Scalar; level <= JsonScanner::bestLevel(); ++level)
+  {
+    JsonScanner::setLevel(static_cast<JsonScanner::Level>(level));
+    JsonScanner scanner;
+    scanner.reset(text.constData(), text.size());
+    EXPECT_EQ(scanner.findStructuralOrQuote(0), 0);
+    int quote = text.indexOf('"');
+    EXPECT_EQ(scanner.findStructuralOrQuote(1), quote) << "level " << level;
+    EXPECT_EQ(scanner.findStructuralOrQuote(quote + 3), text.indexOf(']')) << "level " << level;
+    EXPECT_EQ(scanner.findStructuralOrQuote(text.indexOf(']') + 1), text.size()) << "level " << level;
+  }
+  JsonScanner::setLevel(JsonScanner::bestLevel());
+}
+
+TEST(JsonParserTest, LongStringsAndWhitespaceAcrossBlocks)
+{
+  QByteArray padding(150, ' ');
+  QByteArray longText(200, 'x');
+  QByteArray json = "{" + padding + "\"key\"" + padding + ":\n" + padding +
+      "\"" + longText + "\\\"" + longText + "\"" + padding + "}" + padding;
+
+  JsonModel model;
+  ASSERT_TRUE(model.loadJson(json));
+  QModelIndex root = model.rootIndex();
+  ASSERT_EQ(model.rowCount(root), 1);
+  EXPECT_EQ(model.data(model.index(0, 0, root), Qt::DisplayRole).toString(),
+            "key : \"" + QString(longText) + "\"" + QString(longText) + "\"");
+
+  JsonParser parser;
+  JsonTree tree;
+  QByteArray unterminated = "[\"" + longText;
+  EXPECT_FALSE(parser.parse(unterminated, tree));
+  EXPECT_EQ(parser.error().m_offset, 1);
+
+  QByteArray control = "[\"" + longText + "\n\"]";
+  EXPECT_FALSE(parser.parse(control, tree));
+  EXPECT_EQ(parser.error().m_offset, 2 + longText.size());
+}
+
+static QByteArray makeLargeDocument(bool object)
+{
+  QByteArray json = object ? "{" : "[";
+  for (int i = 0; json.size() < (3 << 20); ++i)
+  {
+    json += i > 0 ? ",\n" : "\n";
+    if (object)
+    {
+      json += "\"key" + QByteArray::number(i) + "\": ";
+    }
+    json += "{\"id\": " + QByteArray::number(i) + ", \"tags\": [\"a,b\", \"}]\\\"\"], \"nested\": {\"x\": [1, [2, {}]]}}";
+  }
+  json += object ? "\n}" : "\n]";
+  return json;
+}
+
+static void expectSameTree(const JsonTree &expected, const JsonTree &actual)
+{
+  ASSERT_EQ(expected.m_nodes.size(), actual.m_nodes.size());
+  ASSERT_EQ(expected.m_childIds, actual.m_childIds);
+  for (int i = 0; i < expected.m_nodes.size(); ++i)
+  {
+    const Node &a = expected.m_nodes.at(i);
+    const Node &b = actual.m_nodes.at(i);
+    ASSERT_EQ(a.m_parent, b.m_parent) << "node " << i;
+    ASSERT_EQ(a.m_row, b.m_row) << "node " << i;
+    ASSERT_EQ(a.m_firstChild, b.m_firstChild) << "node " << i;
+    ASSERT_EQ(a.m_childCount, b.m_childCount) << "node " << i;
+    ASSERT_EQ(expected.keySpan(i).m_offset, actual.keySpan(i).m_offset) << "node " << i;
+    ASSERT_EQ(expected.keySpan(i).m_length, actual.keySpan(i).m_length) << "node " << i;
+    ASSERT_EQ(a.m_value.m_offset, b.m_value.m_offset) << "node " << i;
+    ASSERT_EQ(a.m_value.m_length, b.m_value.m_length) << "node " << i;
+    ASSERT_EQ(a.m_type, b.m_type) << "node " << i;
+  }
+}
+
+TEST(JsonParserTest, ParallelParseMatchesSequential)
+{
+  for (bool object : {false, true})
+  {
+    for (bool lazy : {false, true})
+    {
+      QByteArray json = makeLargeDocument(object);
+      JsonParser sequential;
+      sequential.setThreadCount(1);
+      sequential.setLazy(lazy);
+      JsonTree expected;
+      ASSERT_TRUE(sequential.parse(json, expected));
+
+      JsonParser parallel;
+      parallel.setThreadCount(4);
+      parallel.setLazy(lazy);
+      JsonTree actual;
+      ASSERT_TRUE(parallel.parse(json, actual));
+      expectSameTree(expected, actual);
+    }
+  }
+}
+
+TEST(JsonParserTest, ParallelParseReportsSequentialError)
+{
+  QByteArray json = makeLargeDocument(false);
+  int broken = json.size() * 3 / 4;
+  broken = json.indexOf("\"id\"", broken);
+  json[broken + 5] = ';';
+
+  JsonParser sequential;
+  sequential.setThreadCount(1);
+  JsonTree tree;
+  ASSERT_FALSE(sequential.parse(json, tree));
+
+  JsonParser parallel;
+  parallel.setThreadCount(4);
+  ASSERT_FALSE(parallel.parse(json, tree));
+  EXPECT_TRUE(tree.isEmpty());
+  EXPECT_EQ(parallel.error().m_offset, sequential.error().m_offset);
+  EXPECT_EQ(parallel.error().m_line, sequential.error().m_line);
+  EXPECT_EQ(parallel.error().m_message, sequential.error().m_message);
+}
+
+TEST(JsonParserTest, ParallelParseRejectsMismatchedRootBracket)
+{
+  for (bool object : {false, true})
+  {
+    QByteArray json = makeLargeDocument(object);
+    int rootEnd = json.size() - 1;
+    json[rootEnd] = object ? ']' : '}';
+
+    JsonParser parser;
+    parser.setThreadCount(2);
+    JsonTree tree;
+    ASSERT_FALSE(parser.parse(json, tree)) << "object " << object;
+    EXPECT_TRUE(tree.isEmpty());
+    EXPECT_EQ(parser.error().m_offset, rootEnd);
+  }
+}
+
+TEST(JsonModelTest, JsonLinesAppendRecordsInBatches)
+{
+  QByteArray json = "{\"level\": \"info\", \"n\": 1}\n\n[1, 2]\r\n\"text\"\n{\"level\": \"warn\"}\n";
+  JsonTree root;
+  JsonParser::startLines(json, root);
+
+  JsonModel model;
+  model.setTree(std::move(root));
+  QModelIndex rootIndex = model.rootIndex();
+  EXPECT_EQ(model.rowCount(rootIndex), 0);
+
+  QVector<QPair<int, int>> inserted;
+  QObject::connect(&model, &QAbstractItemModel::rowsInserted, [&](const QModelIndex &parent, int first, int last)
+  {
+    EXPECT_EQ(parent, model.rootIndex());
+    inserted.append(qMakePair(first, last));
+  });
+
+  JsonParser parser;
+  int pos = 0;
+  JsonTree batch;
+  ASSERT_TRUE(parser.parseLines(json, pos, 35, batch));
+  model.appendRecords(batch);
+  ASSERT_TRUE(parser.parseLines(json, pos, json.size(), batch));
+  model.appendRecords(batch);
+  EXPECT_EQ(pos, json.size());
+
+  ASSERT_EQ(inserted.size(), 2);
+  EXPECT_EQ(inserted.at(0), qMakePair(0, 1));
+  EXPECT_EQ(inserted.at(1), qMakePair(2, 3));
+
+  ASSERT_EQ(model.rowCount(rootIndex), 4);
+  EXPECT_EQ(model.data(rootIndex, Qt::DisplayRole).toString(), "array [4]");
+  QModelIndex first = model.index(0, 0, rootIndex);
+  EXPECT_EQ(model.data(first, Qt::DisplayRole).toString(), "0 {2}");
+  EXPECT_EQ(model.data(model.index(1, 0, first), Qt::DisplayRole).toString(), "n : 1");
+  EXPECT_EQ(model.data(model.index(1, 0, rootIndex), Qt::DisplayRole).toString(), "1 [2]");
+  EXPECT_EQ(model.data(model.index(2, 0, rootIndex), Qt::DisplayRole).toString(), "2 : \"text\"");
+
+  QModelIndex last = model.index(3, 0, rootIndex);
+  EXPECT_EQ(model.parent(last), rootIndex);
+  EXPECT_EQ(model.data(model.index(0, 0, last), Qt::DisplayRole).toString(), "level : \"warn\"");
+  EXPECT_EQ(model.parent(model.index(0, 0, last)), last);
+}
+
+TEST(JsonLoaderTest, PublishesTreeBeforeSearchIndex)
+{
+  // Дерево забирается по treeReady(), пока индекс еще не готов; индекс - после завершения
+  JsonLoader loader;
+  JsonTree tree;
+  bool taken = false;
+  bool indexBeforeTree = true;
+  QObject::connect(&loader, &JsonLoader::treeReady, [&]()
+  {
+    JsonSearchIndex early;
+    indexBeforeTree = loader.takeIndex(early);
+    taken = loader.takeTree(tree);
+  }, Qt::DirectConnection);
+  loader.load(QByteArray("{\"name\": \"say \\\"hi\\\"\\n\"}"));
+  ASSERT_TRUE(loader.wait(10000));
+  EXPECT_TRUE(taken);
+  EXPECT_FALSE(indexBeforeTree);
+  EXPECT_EQ(tree.m_nodes.size(), 2);
+
+  JsonSearchIndex index;
+  ASSERT_TRUE(loader.takeIndex(index));
+  EXPECT_EQ(index.find(JsonSearchIndex::escaped("say \"hi\"\n")).size(), 1);
+  EXPECT_TRUE(index.find("say \"hi").isEmpty());
+  EXPECT_EQ(JsonSearchIndex::escaped(QByteArray("a\\b\x01\t")), QByteArray("a\\\\b\\u0001\\t"));
+}
+
+TEST(JsonLoaderTest, JsonLinesKeepRecordsBeforeError)
+{
+  JsonLoader loader;
+  loader.loadLines(QByteArray("{\"a\": 1}\n[2]\n{\"b\": }\n3\n"));
+  ASSERT_TRUE(loader.wait(10000));
+  EXPECT_FALSE(loader.wasCanceled());
+  EXPECT_EQ(loader.error().m_line, 3);
+
+  JsonTree root;
+  ASSERT_TRUE(loader.takeTree(root));
+  JsonModel model;
+  model.setTree(std::move(root));
+  for (const JsonTree &batch : loader.takeBatches())
+  {
+    model.appendRecords(batch);
+  }
+  QModelIndex rootIndex = model.rootIndex();
+  ASSERT_EQ(model.rowCount(rootIndex), 2);
+  EXPECT_EQ(model.data(model.index(1, 0, rootIndex), Qt::DisplayRole).toString(), "1 [1]");
+
+  JsonParser parser;
+  int pos = 0;
+  JsonTree batch;
+  EXPECT_FALSE(parser.parseLines(QByteArray("1 2\n"), pos, 100, batch));
+  EXPECT_EQ(parser.error().m_offset, 2);
+  EXPECT_EQ(batch.m_nodes.at(0).m_childCount, 0);
+}
+
+TEST(JsonLoaderTest, JsonLinesReadsFileInWindows)
+{
+  // Окна по 64 байта: записи попадают в разные окна, длинная строка расширяет окно
+  QByteArray json;
+  for (int i = 0; i < 20; ++i)
+  {
+    json += "{\"n\": " + QByteArray::number(i) + ", \"tags\": [\"t" + QByteArray::number(i) + "\"]}\n";
+  }
+  json += "{\"long\": \"" + QByteArray(300, 'x') + "\"}\n\"last\"";
+  QTemporaryFile tmp;
+  ASSERT_TRUE(tmp.open());
+  tmp.write(json);
+  tmp.close();
+
+  MappedFile file;
+  ASSERT_TRUE(file.open(tmp.fileName(), true));
+  EXPECT_TRUE(file.isWindowed());
+  EXPECT_TRUE(file.bytes().isEmpty());
+  EXPECT_EQ(file.window(json.size() - 6, 6), QByteArray("\"last\""));
+
+  JsonLoader loader;
+  loader.setLazy(true);
+  loader.setWindowBytes(64);
+  loader.loadLines(file);
+  ASSERT_TRUE(loader.wait(10000));
+  EXPECT_EQ(loader.error().m_offset, -1);
+
+  JsonTree root;
+  ASSERT_TRUE(loader.takeTree(root));
+  JsonModel model;
+  model.setTree(std::move(root));
+  for (const JsonTree &batch : loader.takeBatches())
+  {
+    model.appendRecords(batch);
+  }
+  EXPECT_EQ(model.sourceSize(), json.size());
+  QModelIndex rootIndex = model.rootIndex();
+  ASSERT_EQ(model.rowCount(rootIndex), 22);
+  for (int i = 0; i < 20; ++i)
+  {
+    QModelIndex record = model.index(i, 0, rootIndex);
+    model.fetchMore(record);
+    ASSERT_EQ(model.rowCount(record), 2);
+    EXPECT_EQ(model.data(model.index(0, 0, record), Qt::DisplayRole).toString(), "n : " + QString::number(i));
+    QModelIndex tags = model.index(1, 0, record);
+    model.fetchMore(tags);
+    EXPECT_EQ(model.data(model.index(0, 0, tags), Qt::DisplayRole).toString(), "0 : \"t" + QString::number(i) + "\"");
+  }
+  QModelIndex longRecord = model.index(20, 0, rootIndex);
+  model.fetchMore(longRecord);
+  EXPECT_EQ(model.data(model.index(0, 0, longRecord), Qt::DisplayRole).toString(),
+            "long : \"" + QString(300, 'x') + "\"");
+  EXPECT_EQ(model.data(model.index(21, 0, rootIndex), Qt::DisplayRole).toString(), "21 : \"last\"");
+  EXPECT_FALSE(model.updateSource(json));
+
+  // Строка ошибки считается от начала файла, а не окна
+  QByteArray broken = json;
+  broken.replace("{\"n\": 15,", "{\"n\": 15;");
+  QTemporaryFile brokenTmp;
+  ASSERT_TRUE(brokenTmp.open());
+  brokenTmp.write(broken);
+  brokenTmp.close();
+  ASSERT_TRUE(file.open(brokenTmp.fileName(), true));
+  loader.loadLines(file);
+  ASSERT_TRUE(loader.wait(10000));
+  EXPECT_EQ(loader.error().m_line, 16);
+
+  JsonParser parser;
+  JsonTree tree;
+  EXPECT_FALSE(parser.parse(file, tree));
+  EXPECT_TRUE(tree.isEmpty());
+}
+
+TEST(JsonModelTest, UpdateSourceReparsesOnlyEditedElements)
+{
+  JsonModel model;
+  ASSERT_TRUE(model.loadJson(QByteArray("{\"a\": [1, 2, 3], \"b\": {\"c\": \"x\"}, \"d\": true}")));
+  int resets = 0;
+  int inserts = 0;
+  int removes = 0;
+  int changes = 0;
+  QObject::connect(&model, &QAbstractItemModel::modelReset, [&]() { ++resets; });
+  QObject::connect(&model, &QAbstractItemModel::rowsInserted, [&](const QModelIndex &, int, int) { ++inserts; });
+  QObject::connect(&model, &QAbstractItemModel::rowsRemoved, [&](const QModelIndex &, int, int) { ++removes; });
+  QObject::connect(&model, &QAbstractItemModel::dataChanged, [&](const QModelIndex &, const QModelIndex &) { ++changes; });
+
+  QModelIndex root = model.rootIndex();
+  QModelIndex a = model.index(0, 0, root);
+  QModelIndex b = model.index(1, 0, root);
+
+  // Значение без изменения структуры обновляется на месте
+  ASSERT_TRUE(model.updateSource(QByteArray("{\"a\": [1, 20, 3], \"b\": {\"c\": \"x\"}, \"d\": true}")));
+  EXPECT_EQ(changes, 1);
+  EXPECT_EQ(inserts + removes, 0);
+  EXPECT_EQ(model.data(model.index(1, 0, a), Qt::DisplayRole).toString(), "1 : 20");
+  EXPECT_EQ(model.data(model.index(0, 0, b), Qt::DisplayRole).toString(), "c : \"x\"");
+  EXPECT_EQ(model.index(1, 0, root), b);
+
+  // Новый элемент вставляется одной строкой, следующие узлы сдвигаются по тексту
+  ASSERT_TRUE(model.updateSource(QByteArray("{\"a\": [1, 20, 3, [4]], \"b\": {\"c\": \"x\"}, \"d\": true}")));
+  EXPECT_EQ(inserts, 1);
+  EXPECT_EQ(model.data(a, Qt::DisplayRole).toString(), "a [4]");
+  EXPECT_EQ(model.data(model.index(3, 0, a), Qt::DisplayRole).toString(), "3 [1]");
+  EXPECT_EQ(model.data(model.index(0, 0, model.index(3, 0, a)), Qt::DisplayRole).toString(), "0 : 4");
+  EXPECT_EQ(model.data(model.index(0, 0, b), Qt::DisplayRole).toString(), "c : \"x\"");
+  EXPECT_EQ(model.data(model.index(2, 0, root), Qt::DisplayRole).toString(), "d : true");
+
+  // Удаление члена объекта и правка ключа
+  ASSERT_TRUE(model.updateSource(QByteArray("{\"a\": [1, 20, 3, [4]], \"e\": true}")));
+  EXPECT_EQ(removes, 1);
+  ASSERT_EQ(model.rowCount(root), 2);
+  EXPECT_EQ(model.data(model.index(1, 0, root), Qt::DisplayRole).toString(), "e : true");
+  EXPECT_EQ(model.index(0, 0, root), a);
+
+  // Только пробелы: ни одного сигнала
+  int signalCount = inserts + removes + changes;
+  ASSERT_TRUE(model.updateSource(QByteArray("{\"a\": [1,   20, 3, [4]], \"e\": true}")));
+  EXPECT_EQ(inserts + removes + changes, signalCount);
+  EXPECT_EQ(model.data(model.index(1, 0, root), Qt::DisplayRole).toString(), "e : true");
+
+  // Правка вплотную к числу меняет само число
+  ASSERT_TRUE(model.updateSource(QByteArray("{\"a\": [1,   205, 3, [4]], \"e\": true}")));
+  EXPECT_EQ(model.data(model.index(1, 0, a), Qt::DisplayRole).toString(), "1 : 205");
+
+  // Невалидная правка и правка скобок корня требуют полного разбора
+  EXPECT_FALSE(model.updateSource(QByteArray("{\"a\": [1,   205, 3, [4]], \"e\": true,}")));
+  EXPECT_FALSE(model.updateSource(QByteArray("{\"a\": [1,   205 3, [4]], \"e\": true}")));
+  EXPECT_FALSE(model.updateSource(QByteArray("[{\"a\": [1,   205, 3, [4]], \"e\": true}]")));
+  EXPECT_EQ(model.data(model.index(1, 0, a), Qt::DisplayRole).toString(), "1 : 205");
+  EXPECT_EQ(resets, 0);
+}
+
+TEST(JsonModelTest, UpdateSourceBoundsAbandonedNodes)
+{
+  // Каждая правка заменяет массив из 100-101 числа: брошенные узлы копятся,
+  // пока их не станет слишком много, после чего нужен полный разбор
+  auto document = [](int edit)
+  {
+    QByteArray items;
+    for (int i = 0; i < 100 + edit % 2; ++i)
+    {
+      items += (i > 0 ? "," : "") + QByteArray::number(edit);
+    }
+    return "{\"a\": {\"b\": [[" + items + "]], \"c\": \"x\"}, \"d\": [true]}";
+  };
+  JsonModel model;
+  ASSERT_TRUE(model.loadJson(document(0)));
+  QModelIndex root = model.rootIndex();
+  QModelIndex a = model.index(0, 0, root);
+  QModelIndex d = model.index(1, 0, root);
+
+  int edit = 1;
+  for (; edit < 1000 && model.updateSource(document(edit)); ++edit)
+  {
+    // Соседи после правки на всех уровнях сдвинуты по тексту
+    QModelIndex b = model.index(0, 0, a);
+    ASSERT_EQ(model.data(model.index(99, 0, model.index(0, 0, b)), Qt::DisplayRole).toString(),
+              "99 : " + QString::number(edit));
+    ASSERT_EQ(model.data(model.index(1, 0, a), Qt::DisplayRole).toString(), "c : \"x\"");
+    ASSERT_EQ(model.data(model.index(0, 0, d), Qt::DisplayRole).toString(), "0 : true");
+  }
+  EXPECT_GT(edit, 10);
+  EXPECT_LT(edit, 1000);
+  EXPECT_LT(model.nodeCount(), 10000);
+
+  ASSERT_TRUE(model.loadJson(document(edit)));
+  EXPECT_EQ(model.nodeCount(), 107 + edit % 2);
+  EXPECT_TRUE(model.updateSource(document(edit + 1)));
+}
+
+TEST(JsonParserTest, DeepNestingWithoutRecursion)
+{
+  // Глубина, на которой рекурсивный разбор переполнял стек
+  const int depth = 200000;
+  QByteArray json;
+  for (int i = 0; i < depth; ++i)
+  {
+    json += i % 2 ? "{\"k\": " : "[";
+  }
+  json += "0";
+  for (int i = depth - 1; i >= 0; --i)
+  {
+    json += i % 2 ? "}" : "]";
+  }
+
+  JsonParser parser;
+  JsonTree tree;
+  EXPECT_FALSE(parser.parse(json, tree));
+  EXPECT_EQ(parser.error().m_offset, JsonParser::kDefaultMaxDepth / 2 * 7);
+
+  parser.setMaxDepth(depth);
+  ASSERT_TRUE(parser.parse(json, tree));
+  ASSERT_EQ(tree.m_nodes.size(), depth + 1);
+  EXPECT_EQ(tree.m_nodes.at(depth).m_parent, depth - 1);
+  EXPECT_EQ(tree.m_nodes.at(depth - 1).m_value.m_length, 8);
+
+  JsonParser lazy;
+  lazy.setLazy(true);
+  lazy.setMaxDepth(depth);
+  ASSERT_TRUE(lazy.parse(json, tree));
+  EXPECT_EQ(tree.m_nodes.size(), 2);
+  ASSERT_TRUE(lazy.materialize(tree, 1));
+  EXPECT_EQ(tree.m_nodes.size(), 3);
+
+  parser.setMaxDepth(3);
+  EXPECT_TRUE(parser.parse(QByteArray("[[[1]], {\"a\": []}]"), tree));
+  EXPECT_FALSE(parser.parse(QByteArray("[[[[1]]]]"), tree));
+  EXPECT_EQ(parser.error().m_offset, 3);
+}
+
+TEST(JsonModelTest, TracksExpandedContainersIncrementally)
+{
+  JsonParser parser;
+  parser.setLazy(true);
+  JsonTree tree;
+  ASSERT_TRUE(parser.parse(QByteArray("{\"a\": [1, {\"b\": [true]}], \"c\": {}, \"d\": {\"e\": [2]}}"), tree));
+  JsonModel model;
+  model.setTree(std::move(tree));
+  // Корень, "a" и "d"; пустой "c" раскрыть нельзя
+  EXPECT_EQ(model.expandableCount(), 3);
+  EXPECT_FALSE(model.allExpanded());
+
+  QModelIndex root = model.rootIndex();
+  QModelIndex d = model.index(2, 0, root);
+  model.setExpanded(root, true);
+  model.setExpanded(root, true);
+  model.setExpanded(model.index(1, 0, root), true);
+  EXPECT_EQ(model.expandedCount(), 1);
+  model.fetchMore(d);
+  EXPECT_EQ(model.expandableCount(), 4);
+  model.setExpanded(d, true);
+  EXPECT_EQ(model.expandedCount(), 2);
+
+  int resets = 0;
+  int inserts = 0;
+  QObject::connect(&model, &QAbstractItemModel::modelReset, [&]() { ++resets; });
+  QObject::connect(&model, &QAbstractItemModel::rowsInserted, [&](const QModelIndex &, int, int) { ++inserts; });
+  model.fetchAll();
+  EXPECT_EQ(resets, 1);
+  EXPECT_EQ(inserts, 0);
+  EXPECT_EQ(model.expandableCount(), 6);
+  EXPECT_EQ(model.expandedCount(), 0);
+  model.fetchAll();
+  EXPECT_EQ(resets, 1);
+
+  model.setAllExpanded(true);
+  EXPECT_TRUE(model.allExpanded());
+  model.setExpanded(model.index(0, 0, model.rootIndex()), false);
+  EXPECT_FALSE(model.allExpanded());
+  EXPECT_EQ(model.expandedCount(), 5);
+
+  // Удаленное раскрытое поддерево уходит из обоих счетчиков
+  ASSERT_TRUE(model.updateSource(QByteArray("{\"a\": [1, {\"b\": [true]}], \"c\": {}}")));
+  EXPECT_EQ(model.expandableCount(), 4);
+  EXPECT_EQ(model.expandedCount(), 3);
+  model.setExpanded(model.index(0, 0, model.rootIndex()), true);
+  EXPECT_TRUE(model.allExpanded());
+  ASSERT_TRUE(model.updateSource(QByteArray("{\"a\": [1, {\"b\": [true]}], \"c\": {\"f\": 1}}")));
+  EXPECT_EQ(model.expandableCount(), 5);
+  EXPECT_FALSE(model.allExpanded());
+
+  model.setAllExpanded(false);
+  EXPECT_EQ(model.expandedCount(), 0);
+}
+
+TEST(JsonModelTest, CollapseAllSurvivesEpochOverflow)
+{
+  JsonModel model;
+  ASSERT_TRUE(model.loadJson(QByteArray("[[1], [2], {\"a\": [3]}]")));
+  QModelIndex root = model.rootIndex();
+  QModelIndex first = model.index(0, 0, root);
+
+  // Больше 65535 сворачиваний: отметки, оставшиеся от прежних эпох, не оживают
+  for (int i = 0; i < 70000; ++i)
+  {
+    model.setExpanded(first, true);
+    model.setAllExpanded(false);
+  }
+  EXPECT_EQ(model.expandedCount(), 0);
+  model.setExpanded(root, true);
+  model.setExpanded(first, false);
+  model.setExpanded(first, true);
+  EXPECT_EQ(model.expandedCount(), 2);
+
+  model.setAllExpanded(true);
+  EXPECT_TRUE(model.allExpanded());
+  model.setAllExpanded(false);
+  model.setExpanded(model.index(1, 0, root), true);
+  EXPECT_EQ(model.expandedCount(), 1);
+  EXPECT_FALSE(model.allExpanded());
+}
+
+TEST(JsonSearchIndexTest, FindsKeysAndValuesAndLocatesNodes)
+{
+  QByteArray json("{\"Status\": \"active\", \"items\": [{\"status\": \"inactive\", \"id\": 12},"
+                  " {\"status\": \"act\\\"ive\", \"id\": 120}], \"x\": true}");
+  JsonSearchIndex index;
+  index.build(json);
+  EXPECT_EQ(index.tokenCount(), 13);
+
+  QVector<int> hits = index.find("STATUS");
+  ASSERT_EQ(hits.size(), 3);
+  EXPECT_EQ(hits.at(0), 2);
+  EXPECT_EQ(index.find("activ").size(), 2);
+  EXPECT_EQ(index.find("12").size(), 2);
+  EXPECT_EQ(index.find("t\\\"i").size(), 1);
+  EXPECT_EQ(index.find("t").size(), 8);
+  EXPECT_TRUE(index.find("missing").isEmpty());
+  EXPECT_TRUE(index.find("").isEmpty());
+
+  // Путь к найденному узлу достраивается в ленивом дереве
+  JsonParser parser;
+  parser.setLazy(true);
+  JsonTree tree;
+  ASSERT_TRUE(parser.parse(json, tree));
+  JsonModel model;
+  model.setTree(std::move(tree));
+  QVector<int> ids = index.find("120");
+  ASSERT_EQ(ids.size(), 1);
+  QModelIndex found = model.locate(ids.at(0));
+  EXPECT_EQ(model.data(found, Qt::DisplayRole).toString(), "id : 120");
+  EXPECT_EQ(model.data(found.parent(), Qt::DisplayRole).toString(), "1 {2}");
+  EXPECT_EQ(model.expandableCount(), 4);
+
+  found = model.locate(index.find("inactive").at(0));
+  EXPECT_EQ(model.data(found, Qt::DisplayRole).toString(), "status : \"inactive\"");
+  found = model.locate(index.find("items").at(0));
+  EXPECT_EQ(model.data(found, Qt::DisplayRole).toString(), "items [2]");
+  EXPECT_EQ(model.locate(0), model.rootIndex());
+}
+
+TEST(JsonSearchIndexTest, UpdatesOnlyReparsedRangeAfterEdit)
+{
+  QByteArray json("{\"Status\": \"active\", \"items\": [{\"status\": \"inactive\", \"id\": 12},"
+                  " {\"status\": \"act\\\"ive\", \"id\": 120}], \"x\": true}");
+  JsonModel model;
+  ASSERT_TRUE(model.loadJson(json));
+  JsonSearchIndex index;
+  index.build(json);
+
+  // После каждой правки индекс совпадает с построенным заново
+  const char *const edits[][2] = {
+    { "\"id\": 12}", "\"id\": 1234, \"Note\": \"new token\"}" },
+    { "\"inactive\"", "\"on\"" },
+    { ", \"Note\": \"new token\"", "" },
+    { "true", "[\"ab\", 7, \"STATUS\"]" }
+  };
+  const char *const queries[] = { "status", "activ", "12", "t", "on", "new", "ab", "7", "x", "t\\\"i" };
+  for (const auto &edit : edits)
+  {
+    SCOPED_TRACE(edit[1]);
+    QByteArray updated = json;
+    updated.replace(edit[0], edit[1]);
+    ASSERT_NE(updated, json);
+    TextSpan replaced;
+    ASSERT_TRUE(model.updateSource(updated, &replaced));
+    ASSERT_GE(replaced.m_offset, 0);
+    int oldEnd = replaced.m_offset + replaced.m_length;
+    index.update(updated, replaced.m_offset, oldEnd, oldEnd + updated.size() - json.size());
+    json = updated;
+
+    JsonSearchIndex fresh;
+    fresh.build(json);
+    EXPECT_EQ(index.tokenCount(), fresh.tokenCount());
+    for (const char *query : queries)
+    {
+      EXPECT_EQ(index.find(query), fresh.find(query)) << query;
+    }
+  }
+}
+
+TEST(JsonQueryTest, EvaluatesPathAndPointerOverLazyTree)
+{
+  QByteArray json("{\"items\": [{\"status\": \"ok\", \"id\": 1}, {\"status\": \"fail\", \"id\": 2},"
+                  " {\"id\": 3, \"tags\": {\"status\": \"x\"}}], \"a/b\": {\"m~n\": [10, 20, 30]}, \"odd key\": 5}");
+  JsonParser parser;
+  parser.setLazy(true);
+  JsonTree tree;
+  ASSERT_TRUE(parser.parse(json, tree));
+  JsonModel model;
+  model.setTree(std::move(tree));
+
+  auto texts = [&model](const QString &expression)
+  {
+    JsonQuery query;
+    QStringList result;
+    if (!query.compile(expression))
+    {
+      result.append("error: " + query.errorString());
+      return result;
+    }
+    for (const QModelIndex &index : model.query(query))
+    {
+      result.append(model.data(index, Qt::DisplayRole).toString());
+    }
+    return result;
+  };
+
+  EXPECT_EQ(texts("$.items[*].status"), QStringList({"status : \"ok\"", "status : \"fail\""}));
+  EXPECT_EQ(texts("$..status"), QStringList({"status : \"ok\"", "status : \"fail\"", "status : \"x\""}));
+  EXPECT_EQ(texts("$.items[-1].id"), QStringList({"id : 3"}));
+  EXPECT_EQ(texts("$['a/b'][\"m~n\"][1:]"), QStringList({"1 : 20", "2 : 30"}));
+  EXPECT_EQ(texts("$['odd key']"), QStringList({"odd key : 5"}));
+  EXPECT_EQ(texts("$.items[5]").size(), 0);
+  EXPECT_EQ(texts("$.items.status").size(), 0);
+  EXPECT_EQ(texts("$").size(), 1);
+
+  EXPECT_EQ(texts("/items/1/status"), QStringList({"status : \"fail\""}));
+  EXPECT_EQ(texts("/a~1b/m~0n/0"), QStringList({"0 : 10"}));
+  EXPECT_EQ(texts("/items/01").size(), 0);
+  EXPECT_EQ(texts("").size(), 1);
+
+  JsonQuery query;
+  EXPECT_FALSE(query.compile("items"));
+  EXPECT_FALSE(query.compile("$.items["));
+  EXPECT_FALSE(query.compile("$.items[abc]"));
+  EXPECT_FALSE(query.compile("$."));
+  EXPECT_FALSE(query.compile("/a~2"));
+  EXPECT_FALSE(query.isValid());
+  EXPECT_FALSE(query.errorString().isEmpty());
+}
+
+TEST(JsonQueryTest, DescendantQueryBuildsTreeOnceAndMatchesDecodedKeys)
+{
+  QByteArray json("{\"a\": {\"b\\u0061d\": 1, \"x\": [{\"say \\\"hi\\\"\": 2}]}, \"c\": {\"bad\": 3}}");
+  JsonParser parser;
+  parser.setLazy(true);
+  JsonTree tree;
+  ASSERT_TRUE(parser.parse(json, tree));
+  JsonModel model;
+  model.setTree(std::move(tree));
+  int resets = 0;
+  int inserts = 0;
+  QObject::connect(&model, &QAbstractItemModel::modelReset, [&]() { ++resets; });
+  QObject::connect(&model, &QAbstractItemModel::rowsInserted, [&](const QModelIndex &, int, int) { ++inserts; });
+
+  // Потомки: одно достраивание всего дерева вместо fetchMore() для каждого контейнера
+  JsonQuery query;
+  ASSERT_TRUE(query.compile("$..bad"));
+  EXPECT_TRUE(query.hasDescendants());
+  EXPECT_EQ(model.query(query).size(), 2);
+  EXPECT_EQ(resets, 1);
+  EXPECT_EQ(inserts, 0);
+
+  // Ключи сравниваются после раскрытия escape
+  ASSERT_TRUE(query.compile("$..['say \"hi\"']"));
+  EXPECT_EQ(model.query(query).size(), 1);
+  ASSERT_TRUE(query.compile("/a/bad"));
+  EXPECT_FALSE(query.hasDescendants());
+  EXPECT_EQ(model.query(query).size(), 1);
+  ASSERT_TRUE(query.compile("$.a['b\\u0061d']"));
+  EXPECT_TRUE(model.query(query).isEmpty());
+}
+
+TEST(JsonQueryTest, ChainedDescendantStepsReturnEachNodeOnce)
+{
+  // Узлы a вложены друг в друга: b внутри внутреннего a - потомок обоих
+  QByteArray json("{\"a\": {\"a\": {\"b\": 1, \"c\": {\"b\": 2}}, \"b\": 3}, \"x\": [{\"a\": [{\"b\": 4}]}]}");
+  for (bool lazy : { false, true })
+  {
+    SCOPED_TRACE(lazy);
+    JsonParser parser;
+    parser.setLazy(lazy);
+    JsonTree tree;
+    ASSERT_TRUE(parser.parse(json, tree));
+    JsonQuery query;
+    ASSERT_TRUE(query.compile("$..a..b"));
+    QVector<int> ids = query.evaluate(tree, [&tree, &parser](int id)
+    {
+      parser.materialize(tree, id);
+    });
+    QStringList values;
+    for (int id : ids)
+    {
+      const Node &node = tree.m_nodes.at(id);
+      values.append(QString::fromUtf8(tree.m_source.mid(node.m_value.m_offset, node.m_value.m_length)));
+    }
+    values.sort();
+    EXPECT_EQ(values, QStringList({ "1", "2", "3", "4" }));
+  }
+}
+
+TEST(JsonLexerTest, TokenizesLinesAndCarriesStringState)
+{
+  QVector<JsonToken> tokens;
+  int state = JsonLexer::tokenize(QStringLiteral("  \"key\" : \"a \\\" b\", \"n\": -1.5e3, \"t\": true, x: null"), JsonLexer::Normal, tokens);
+  EXPECT_EQ(state, JsonLexer::Normal);
+  ASSERT_EQ(tokens.size(), 7);
+  EXPECT_EQ(tokens[0].m_kind, JsonToken::Key);
+  EXPECT_EQ(tokens[0].m_start, 2);
+  EXPECT_EQ(tokens[0].m_length, 5);
+  EXPECT_EQ(tokens[1].m_kind, JsonToken::String);
+  EXPECT_EQ(tokens[1].m_length, 8);
+  EXPECT_EQ(tokens[2].m_kind, JsonToken::Key);
+  EXPECT_EQ(tokens[3].m_kind, JsonToken::Number);
+  EXPECT_EQ(tokens[3].m_length, 6);
+  EXPECT_EQ(tokens[4].m_kind, JsonToken::Key);
+  EXPECT_EQ(tokens[5].m_kind, JsonToken::Literal);
+  EXPECT_EQ(tokens[6].m_kind, JsonToken::Literal);
+  EXPECT_EQ(tokens[6].m_length, 4);
+
+  // Незакрытая строка продолжается на следующей строке текста,
+  // в том числе после экранирующей обратной косой черты
+  tokens.clear();
+  state = JsonLexer::tokenize(QStringLiteral("[\"open \\"), JsonLexer::Normal, tokens);
+  EXPECT_EQ(state, JsonLexer::InEscape);
+  state = JsonLexer::tokenize(QStringLiteral("\" still"), state, tokens);
+  EXPECT_EQ(state, JsonLexer::InString);
+  state = JsonLexer::tokenize(QStringLiteral("end\": 1]"), state, tokens);
+  EXPECT_EQ(state, JsonLexer::Normal);
+  ASSERT_EQ(tokens.size(), 4);
+  EXPECT_EQ(tokens[0].m_kind, JsonToken::String);
+  EXPECT_EQ(tokens[1].m_length, 7);
+  EXPECT_EQ(tokens[2].m_kind, JsonToken::Key);
+  EXPECT_EQ(tokens[2].m_length, 4);
+  EXPECT_EQ(tokens[3].m_kind, JsonToken::Number);
+}
+
+// Фоновой подсветке нужен цикл событий, представлениям - QApplication;
+// без дисплея тесты рисуют через платформу offscreen
+static void ensureApplication()
+{
+  if (!QCoreApplication::instance())
+  {
+    if (!qEnvironmentVariableIsSet("QT_QPA_PLATFORM"))
+    {
+      qputenv("QT_QPA_PLATFORM", "offscreen");
+    }
+    static int argc = 1;
+    static char name[] = "TestsJsonViewer";
+    static char *argv[] = {name, nullptr};
+    new QApplication(argc, argv);
+  }
+}
+
+static bool isFormatted(QTextDocument &document, int block)
+{
+  return !document.findBlockByNumber(block).layout()->formats().isEmpty();
+}
+
+TEST(JsonHighlighterTest, ChoosesModeBySize)
+{
+  ensureApplication();
+  QTextDocument document;
+  JsonHighlighter highlighter;
+  highlighter.setDeferThreshold(100);
+  highlighter.setPlainThreshold(1000);
+
+  EXPECT_EQ(highlighter.prepare(&document, 100), JsonHighlighter::Full);
+  EXPECT_EQ(highlighter.document(), &document);
+  // Отложенная подсветка подключает документ только после замены текста
+  EXPECT_EQ(highlighter.prepare(&document, 101), JsonHighlighter::Deferred);
+  EXPECT_EQ(highlighter.document(), nullptr);
+  highlighter.attach();
+  EXPECT_EQ(highlighter.document(), &document);
+  EXPECT_EQ(highlighter.prepare(&document, 1001), JsonHighlighter::Plain);
+  EXPECT_EQ(highlighter.document(), nullptr);
+  highlighter.attach();
+  EXPECT_EQ(highlighter.document(), nullptr);
+}
+
+TEST(JsonHighlighterTest, DeferredFormatsVisibleLinesFirstAndFinishesInSlices)
+{
+  ensureApplication();
+  QString text;
+  for (int i = 0; i < 1000; ++i)
+  {
+    text += QStringLiteral("  \"key\": \"value\",\n");
+  }
+  QTextDocument document;
+  JsonHighlighter highlighter;
+  highlighter.setDeferThreshold(1);
+  ASSERT_EQ(highlighter.prepare(&document, text.size()), JsonHighlighter::Deferred);
+  highlighter.takeElapsed();
+  document.setPlainText(text);
+  // Во время замены текста ни одна строка не разбирается
+  EXPECT_EQ(highlighter.takeElapsed(), 0);
+
+  highlighter.attach();
+  highlighter.setVisibleBlocks(500, 509);
+  EXPECT_TRUE(isFormatted(document, 0));
+  EXPECT_TRUE(isFormatted(document, 500));
+  EXPECT_TRUE(isFormatted(document, 509));
+  EXPECT_FALSE(isFormatted(document, 300));
+  EXPECT_FALSE(isFormatted(document, 999));
+
+  QElapsedTimer timer;
+  timer.start();
+  while (highlighter.mode() == JsonHighlighter::Deferred && timer.elapsed() < 10000)
+  {
+    QCoreApplication::processEvents();
+  }
+  EXPECT_EQ(highlighter.mode(), JsonHighlighter::Full);
+  for (int block : {0, 300, 505, 999})
+  {
+    EXPECT_TRUE(isFormatted(document, block)) << block;
+  }
+  EXPECT_FALSE(isFormatted(document, 1000));
+}
+
+TEST(JsonLexerTest, ScanMatchesTokenizeState)
+{
+  // Состояние после байтов совпадает с состоянием разбора на лексемы, в том числе
+  // при продолжении с середины строки и после экранирования
+  const QByteArray samples[] = {
+    "{\"a\": \"b\\\"c\", \"d\": 1}",
+    "[\"open \\",
+    "\"x\\\\\" \"y",
+    "\"ключ\": \"значение"
+  };
+  for (const QByteArray &sample : samples)
+  {
+    for (int cut = 0; cut <= sample.size(); ++cut)
+    {
+      SCOPED_TRACE(sample.left(cut).constData());
+      QVector<JsonToken> tokens;
+      int state = JsonLexer::scan(sample.constData(), cut, JsonLexer::Normal);
+      int expected = JsonLexer::tokenize(QString::fromUtf8(sample.left(cut)), JsonLexer::Normal, tokens);
+      EXPECT_EQ(state, expected);
+      int rest = JsonLexer::scan(sample.constData() + cut, sample.size() - cut, state);
+      EXPECT_EQ(rest, JsonLexer::scan(sample.constData(), sample.size(), JsonLexer::Normal));
+    }
+  }
+}
+
+TEST(LargeTextViewTest, ScrollsLongSingleLineByColumns)
+{
+  ensureApplication();
+  QByteArray json("[");
+  while (json.size() < (16 << 20))
+  {
+    json += "{\"key\": \"value \\\" x\", \"n\": 12345},";
+  }
+  json += "0]";
+
+  LargeTextView view;
+  view.resize(400, 200);
+  view.setSource(json);
+  // Горизонтальная прокрутка по столбцам: диапазон не зависит от ширины символа в пикселях
+  QScrollBar *bar = view.horizontalScrollBar();
+  EXPECT_EQ(bar->singleStep(), 1);
+  EXPECT_EQ(bar->maximum() + bar->pageStep(), json.size() + 1);
+
+  // Отрисовка декодирует и раскрашивает только видимые столбцы строки:
+  // 30 кадров по 16 МБ строке укладываются в бюджет с большим запасом
+  QImage image(view.viewport()->size(), QImage::Format_ARGB32);
+  QElapsedTimer timer;
+  timer.start();
+  for (int frame = 0; frame < 30; ++frame)
+  {
+    bar->setValue(int(qint64(bar->maximum()) * frame / 29));
+    view.viewport()->render(&image);
+  }
+  EXPECT_LT(timer.elapsed(), 3000);
+}
+
+TEST(LargeTextViewTest, HoldsFileMappingOfShownText)
+{
+  ensureApplication();
+  QByteArray json = "[\n  {\"key\": \"value\"},\n  2\n]\n";
+  QTemporaryFile tmp;
+  ASSERT_TRUE(tmp.open());
+  tmp.write(json);
+  tmp.close();
+
+  LargeTextView view;
+  view.resize(400, 200);
+  {
+    // Модель переходит к другому документу и отпускает свою копию отображения
+    MappedFile file;
+    ASSERT_TRUE(file.open(tmp.fileName()));
+    JsonModel model;
+    ASSERT_TRUE(model.loadFile(file));
+    view.setSource(model.source(), model.file());
+  }
+  EXPECT_EQ(view.source(), json);
+  QImage image(view.viewport()->size(), QImage::Format_ARGB32);
+  view.viewport()->render(&image);
+}
+
+TEST(TextLineIndexTest, IndexesLinesWithMixedEndings)
+{
+  QByteArray text = "{\r\n  \"a\": 1,\n\n  \"long\": \"value\"\r\n}";
+  TextLineIndex lines;
+  lines.build(text);
+
+  ASSERT_EQ(lines.lineCount(), 5);
+  EXPECT_EQ(text.mid(lines.lineStart(0), lines.lineEnd(0) - lines.lineStart(0)), "{");
+  EXPECT_EQ(text.mid(lines.lineStart(1), lines.lineEnd(1) - lines.lineStart(1)), "  \"a\": 1,");
+  EXPECT_EQ(lines.lineEnd(2), lines.lineStart(2));
+  EXPECT_EQ(text.mid(lines.lineStart(4), lines.lineEnd(4) - lines.lineStart(4)), "}");
+  EXPECT_EQ(lines.maxLineLength(), 17);
+
+  EXPECT_EQ(lines.lineAt(0), 0);
+  EXPECT_EQ(lines.lineAt(2), 0);
+  EXPECT_EQ(lines.lineAt(3), 1);
+  EXPECT_EQ(lines.lineAt(text.indexOf("long")), 3);
+  EXPECT_EQ(lines.lineAt(text.size() - 1), 4);
+
+  lines.build(QByteArray());
+  EXPECT_EQ(lines.lineCount(), 1);
+  EXPECT_EQ(lines.lineEnd(0), 0);
+}
+
+TEST(JsonCorpusTest, GeneratesDeterministicValidDocuments)
+{
+  for (int kind = 0; kind < JsonCorpus::kKindCount; ++kind)
+  {
+    SCOPED_TRACE(JsonCorpus::name(JsonCorpus::Kind(kind)));
+    QByteArray json = JsonCorpus::generate(JsonCorpus::Kind(kind), 64 << 10);
+    EXPECT_GE(json.size(), 64 << 10);
+    EXPECT_EQ(json, JsonCorpus::generate(JsonCorpus::Kind(kind), 64 << 10));
+    EXPECT_NE(json, JsonCorpus::generate(JsonCorpus::Kind(kind), 64 << 10, 2));
+
+    JsonTree tree;
+    JsonParser parser;
+    if (kind == JsonCorpus::Lines)
+    {
+      int pos = 0;
+      EXPECT_TRUE(parser.parseLines(json, pos, json.size(), tree));
+      EXPECT_EQ(pos, json.size());
+    }
+    else
+    {
+      EXPECT_TRUE(parser.parse(json, tree));
+    }
+  }
+}
+
+// Бюджеты на корпусах по 4 МБ. Скорость разбора - нижняя граница с запасом,
+// чтобы тест проходил и в отладочной сборке: он ловит деградацию в разы
+// (квадратичный разбор, лишние копии), а не на проценты. Память на узел считается
+// по емкости массивов дерева и от сборки не зависит. При осознанном изменении
+// значения переписываются по новому замеру.
+TEST(JsonPerfBudgetTest, ParseThroughputAndMemoryPerNode)
+{
+  struct Budget
+  {
+    JsonCorpus::Kind m_kind;
+    double m_minMBps;
+    double m_maxBytesPerNode;
+  };
+  const Budget budgets[] = {
+    { JsonCorpus::Records, 10, 48 },
+    { JsonCorpus::Deep, 3, 52 },
+    { JsonCorpus::Strings, 20, 80 },
+    { JsonCorpus::Numbers, 8, 48 },
+    { JsonCorpus::Lines, 8, 76 },
+    { JsonCorpus::Keys, 10, 64 }
+  };
+
+  for (const Budget &budget : budgets)
+  {
+    SCOPED_TRACE(JsonCorpus::name(budget.m_kind));
+    QByteArray json = JsonCorpus::generate(budget.m_kind, 4 << 20);
+
+    // Лучший из трех запусков: единичные задержки планировщика не должны ронять тест
+    qint64 bestNs = -1;
+    JsonTree tree;
+    for (int run = 0; run < 3; ++run)
+    {
+      tree = JsonTree();
+      JsonParser parser;
+      QElapsedTimer timer;
+      timer.start();
+      if (budget.m_kind == JsonCorpus::Lines)
+      {
+        int pos = 0;
+        ASSERT_TRUE(parser.parseLines(json, pos, json.size(), tree));
+      }
+      else
+      {
+        ASSERT_TRUE(parser.parse(json, tree));
+      }
+      qint64 ns = timer.nsecsElapsed();
+      bestNs = bestNs < 0 ? ns : qMin(bestNs, ns);
+    }
+
+    double mbps = json.size() / 1048576.0 / (qMax<qint64>(bestNs, 1) / 1e9);
+    double bytesPerNode = double(tree.memoryUsage()) / tree.m_nodes.size();
+    EXPECT_GE(mbps, budget.m_minMBps);
+    EXPECT_LE(bytesPerNode, budget.m_maxBytesPerNode);
+    // Уникальные ключи не копятся в таблице ключей
+    EXPECT_LE(tree.m_keys.size(), int(JsonKeyTable::kMaxKeys));
+  }
+}
+
+TEST(LoadProfileTest, AccumulatesPhasesAndFormatsLogLine)
+{
+  LoadProfile profile;
+  EXPECT_TRUE(profile.isEmpty());
+  profile.addTime("parse", 2000000);
+  profile.addTime("model", 500000);
+  profile.addTime("parse", 1000000);
+  {
+    LoadProfile::Scope scope(profile, "layout");
+  }
+  profile.setCounter("nodes", 7);
+  profile.setCounter("nodes", 42);
+
+  EXPECT_EQ(profile.time("parse"), 3000000);
+  EXPECT_GE(profile.time("layout"), 0);
+  EXPECT_EQ(profile.time("missing"), 0);
+  EXPECT_EQ(profile.counter("nodes"), 42);
+  EXPECT_EQ(profile.totalTime(), 3500000 + profile.time("layout"));
+  EXPECT_TRUE(profile.logLine().startsWith("load status=ok total_ms="));
+  EXPECT_TRUE(profile.logLine().contains(" parse_ms=3.0 model_ms=0.5 layout_ms="));
+  EXPECT_TRUE(profile.logLine().endsWith(" nodes=42"));
+  EXPECT_TRUE(profile.summary().startsWith("Загрузка 3 мс"));
+  profile.setStatus(LoadProfile::Canceled);
+  EXPECT_TRUE(profile.logLine().startsWith("load status=canceled total_ms="));
+  EXPECT_TRUE(profile.summary().startsWith("Загрузка отменена, 3 мс"));
+
+  // Этапы фонового потока загрузчика переносятся в замер окна
+  JsonLoader loader;
+  loader.load(QByteArray("[1, 2, 3]"));
+  ASSERT_TRUE(loader.wait(10000));
+  LoadProfile merged;
+  merged.addTime("open", 100);
+  merged.merge(loader.profile());
+  EXPECT_EQ(merged.time("open"), 100);
+  EXPECT_GT(merged.time("parse"), 0);
+  EXPECT_TRUE(merged.logLine().contains(" index_ms="));
+  EXPECT_EQ(merged.status(), LoadProfile::Ok);
+
+  // Неудачная и отмененная загрузки тоже дают замер со своим итогом
+  loader.load(QByteArray("[1, 2"));
+  ASSERT_TRUE(loader.wait(10000));
+  EXPECT_EQ(loader.profile().status(), LoadProfile::Error);
+  EXPECT_GT(loader.profile().time("parse"), 0);
+  merged.merge(loader.profile());
+  EXPECT_TRUE(merged.logLine().startsWith("load status=error "));
+  merged.clear();
+  EXPECT_EQ(merged.status(), LoadProfile::Ok);
+
+  loader.loadLines(QByteArray("{\"a\": 1}\n{\"a\": 2\n"));
+  ASSERT_TRUE(loader.wait(10000));
+  EXPECT_EQ(loader.profile().status(), LoadProfile::Error);
+
+  QByteArray big = "[";
+  for (int i = 0; i < 1000000; ++i)
+  {
+    big += "1, ";
+  }
+  big += "1]";
+  loader.load(big);
+  loader.cancel();
+  ASSERT_TRUE(loader.wait(10000));
+  EXPECT_EQ(loader.profile().status(), loader.wasCanceled() ? LoadProfile::Canceled : LoadProfile::Ok);
+}
+
+TEST(JsonParserTest, InternsRepeatedObjectKeys)
+{
+  QByteArray json = "[{\"id\": 1, \"name\": \"a\"}, {\"id\": 2, \"name\": \"b\"}, {\"name\": \"c\", \"id\": 3, \"x\\\"y\": 0}]";
+  JsonTree tree;
+  ASSERT_TRUE(JsonParser().parse(json, tree));
+
+  ASSERT_EQ(tree.m_keys.size(), 3);
+  int id = tree.m_keys.find("id");
+  int name = tree.m_keys.find("name");
+  EXPECT_EQ(tree.m_keys.find("x\\\"y"), 2);
+  EXPECT_EQ(tree.m_keys.find("missing"), -1);
+  for (int record = 0; record < 3; ++record)
+  {
+    int recordId = tree.childId(0, record);
+    for (int row = 0; row < 2; ++row)
+    {
+      int memberId = tree.childId(recordId, row);
+      int expected = (record == 2) == (row == 0) ? name : id;
+      EXPECT_EQ(tree.m_nodes.at(memberId).m_keyId, expected) << record << " " << row;
+      TextSpan span = tree.keySpan(memberId);
+      EXPECT_EQ(json.mid(span.m_offset, span.m_length), tree.m_keys.key(expected));
+    }
+  }
+
+  // Ключи частей (ленивая загрузка, частичное обновление) попадают в ту же таблицу
+  JsonModel model;
+  ASSERT_TRUE(model.loadJson(json));
+  QByteArray edited = json;
+  edited.replace("\"id\": 2", "\"key\": 2");
+  ASSERT_TRUE(model.updateSource(edited));
+  QModelIndex second = model.index(1, 0, model.rootIndex());
+  EXPECT_EQ(model.data(model.index(0, 0, second), Qt::DisplayRole).toString(), "key : 2");
+  EXPECT_EQ(model.data(model.index(1, 0, model.index(2, 0, model.rootIndex())), Qt::DisplayRole).toString(), "id : 3");
+  EXPECT_EQ(model.data(model.index(2, 0, model.index(2, 0, model.rootIndex())), Qt::DisplayRole).toString(), "x\"y : 0");
+
+  JsonQuery query;
+  ASSERT_TRUE(query.compile("$[*].key"));
+  EXPECT_EQ(model.query(query).size(), 1);
+}
+
+TEST(JsonParserTest, KeepsUniqueKeysBeyondTableInSource)
+{
+  // Словарь с уникальными ключами заполняет таблицу, остальные ключи берутся из текста
+  const int count = JsonKeyTable::kMaxKeys + 3;
+  QByteArray json = "{";
+  for (int i = 0; i < count; ++i)
+  {
+    json += QByteArray(i > 0 ? ", " : "") + "\"k" + QByteArray::number(i) + "\" : " + QByteArray::number(i);
+  }
+  json += ", \"q\\\"\\\\\"\t:\n\"s\", \"k1\": {\"k2\": [1]}}";
+  JsonTree tree;
+  ASSERT_TRUE(JsonParser().parse(json, tree));
+  EXPECT_EQ(tree.m_keys.size(), int(JsonKeyTable::kMaxKeys));
+
+  int last = tree.childId(0, count - 1);
+  EXPECT_EQ(tree.m_nodes.at(last).m_keyId, int(JsonKeyTable::kNotInterned));
+  TextSpan span = tree.keySpan(last);
+  EXPECT_EQ(json.mid(span.m_offset, span.m_length), "k" + QByteArray::number(count - 1));
+  int escaped = tree.childId(0, count);
+  span = tree.keySpan(escaped);
+  EXPECT_EQ(json.mid(span.m_offset, span.m_length), "q\\\"\\\\");
+  // Известный ключ по-прежнему получает id из таблицы
+  EXPECT_EQ(tree.m_nodes.at(tree.childId(0, count + 1)).m_keyId, tree.m_keys.find("k1"));
+
+  JsonModel model;
+  ASSERT_TRUE(model.loadJson(json));
+  QModelIndex root = model.rootIndex();
+  EXPECT_EQ(model.data(model.index(count - 1, 0, root), Qt::DisplayRole).toString(), "k" + QString::number(count - 1) + " : " + QString::number(count - 1));
+  EXPECT_EQ(model.data(model.index(count, 0, root), Qt::DisplayRole).toString(), "q\"\\ : \"s\"");
+
+  JsonQuery query;
+  ASSERT_TRUE(query.compile("$['q\"\\\\']"));
+  EXPECT_EQ(model.query(query).size(), 1);
+  ASSERT_TRUE(query.compile("$..k" + QString::number(count - 2)));
+  EXPECT_EQ(model.query(query).size(), 1);
+  ASSERT_TRUE(query.compile("$..k2"));
+  EXPECT_EQ(model.query(query).size(), 2);
+
+  // Правка рядом с ключом вне таблицы сдвигает его вместе со значением
+  QByteArray edited = json;
+  edited.replace("\"k0\" : 0", "\"k0\" : 10");
+  ASSERT_TRUE(model.updateSource(edited));
+  EXPECT_EQ(model.data(model.index(count - 1, 0, root), Qt::DisplayRole).toString(), "k" + QString::number(count - 1) + " : " + QString::number(count - 1));
+  EXPECT_EQ(model.locate(edited.indexOf("\"k1\": {")), model.index(count + 1, 0, root));
+}
+
+TEST(JsonParserTest, DecodesAllStringEscapes)
+{
+  auto decode = [](const QByteArray &raw)
+  {
+    return JsonParser::decodeString(raw.constData(), raw.size());
+  };
+  EXPECT_EQ(decode("plain \xd1\x82\xd0\xb5\xd0\xba\xd1\x81\xd1\x82"), QString::fromUtf8("plain \xd1\x82\xd0\xb5\xd0\xba\xd1\x81\xd1\x82"));
+  EXPECT_EQ(decode(R"(\"q\" \\ \/ \b\f\n\r\t)"), QString("\"q\" \\ / \b\f\n\r\t"));
+  EXPECT_EQ(decode(R"(A\u00e9\u20AC)"), QString::fromUtf8("A\xc3\xa9\xe2\x82\xac"));
+  EXPECT_EQ(decode(R"(x\ud83d\uDE00y)"), QString::fromUtf8("x\xf0\x9f\x98\x80y"));
+  // Одиночные половины суррогатной пары заменяются на U+FFFD
+  EXPECT_EQ(decode(R"(\ud83d!)"), QString::fromUtf8("\xef\xbf\xbd!"));
+  EXPECT_EQ(decode(R"(\ude00\ud83dA)"), QString::fromUtf8("\xef\xbf\xbd\xef\xbf\xbd" "A"));
+  EXPECT_EQ(decode(""), QString());
+
+  JsonModel model;
+  ASSERT_TRUE(model.loadJson(R"({"caf\u00e9": "line\nnext \ud83d\ude00"})"));
+  EXPECT_EQ(model.data(model.index(0, 0, model.rootIndex()), Qt::DisplayRole).toString(),
+            QString::fromUtf8("caf\xc3\xa9 : \"line\nnext \xf0\x9f\x98\x80\""));
+}